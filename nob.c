@@ -27,8 +27,30 @@ void libs(Nob_Cmd *cmd) {
     nob_cmd_append(cmd, "-l:libraylib.so", "-lm", "-ldl", "-lpthread");
 }
 
+// Everything a plugin is compiled from besides its own source. panim rebuilds the plugin
+// when any of them changes, so they are checked here too.
+static const char *plug_dependencies[] = {
+    SRC_DIR"/tasks.c",
+    SRC_DIR"/tasks.h",
+    SRC_DIR"/env.h",
+    SRC_DIR"/trace.h",
+    SRC_DIR"/assets.h",
+    SRC_DIR"/glyphs.h",
+    SRC_DIR"/interpolators.h",
+    SRC_DIR"/arena.h",
+};
+
+int plug_needs_rebuild(const char *source_path, const char *output_path) {
+    const char *input_paths[1 + NOB_ARRAY_LEN(plug_dependencies)];
+    input_paths[0] = source_path;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(plug_dependencies); ++i) {
+        input_paths[i + 1] = plug_dependencies[i];
+    }
+    return nob_needs_rebuild(output_path, input_paths, NOB_ARRAY_LEN(input_paths));
+}
+
 bool build_plug_c(bool force, Nob_Cmd *cmd, const char *source_path, const char *output_path) {
-    int rebuild_is_needed = nob_needs_rebuild1(output_path, source_path);
+    int rebuild_is_needed = plug_needs_rebuild(source_path, output_path);
     if (rebuild_is_needed < 0) return false;
 
     if (force || rebuild_is_needed) {
@@ -46,7 +68,7 @@ bool build_plug_c(bool force, Nob_Cmd *cmd, const char *source_path, const char
 }
 
 bool build_plug_cxx(bool force, Nob_Cmd *cmd, const char *source_path, const char *output_path) {
-    int rebuild_is_needed = nob_needs_rebuild1(output_path, source_path);
+    int rebuild_is_needed = plug_needs_rebuild(source_path, output_path);
     if (rebuild_is_needed < 0) return false;
 
     if (force || rebuild_is_needed) {
@@ -63,24 +85,135 @@ bool build_plug_cxx(bool force, Nob_Cmd *cmd, const char *source_path, const cha
     return true;
 }
 
-bool build_panim(bool force, Nob_Cmd *cmd) {
+typedef struct {
+    const char *name;
+    const char *source_path;
+    const char *output_path;
+    bool cxx;
+} Plug_Target;
+
+static Plug_Target plugs[] = {
+    { "tm",       SRC_DIR"/tm.c",       BUILD_DIR"libtm.so",       false },
+    { "template", SRC_DIR"/template.c", BUILD_DIR"libtemplate.so", false },
+    { "squares",  SRC_DIR"/squares.c",  BUILD_DIR"libsquares.so",  false },
+    { "bezier",   SRC_DIR"/bezier.c",   BUILD_DIR"libbezier.so",   false },
+    { "probe",    SRC_DIR"/probe.cpp",  BUILD_DIR"libprobe.so",    true  },
+};
+
+bool build_plug(bool force, Nob_Cmd *cmd, Plug_Target plug) {
+    if (plug.cxx) return build_plug_cxx(force, cmd, plug.source_path, plug.output_path);
+    return build_plug_c(force, cmd, plug.source_path, plug.output_path);
+}
+
+// The offline baker of the asset pack, see pack.h
+bool build_packer(bool force, Nob_Cmd *cmd) {
+    const char *output_path = BUILD_DIR"packer";
+    const char *input_paths[] = {
+        SRC_DIR"/packer.c",
+        SRC_DIR"/pack.c",
+        SRC_DIR"/pack.h",
+    };
+    int rebuild_is_needed = nob_needs_rebuild(output_path, input_paths, NOB_ARRAY_LEN(input_paths));
+    if (rebuild_is_needed < 0) return false;
+
+    if (force || rebuild_is_needed) {
+        cmd->count = 0;
+        cc(cmd);
+        nob_cmd_append(cmd, "-o", output_path, SRC_DIR"/packer.c", SRC_DIR"/pack.c");
+        libs(cmd);
+        return nob_cmd_run_sync(*cmd);
+    }
+
+    nob_log(NOB_INFO, "%s is up-to-date", output_path);
+    return true;
+}
+
+bool bake_pack(bool force, Nob_Cmd *cmd) {
+    if (!build_packer(force, cmd)) return false;
+    cmd->count = 0;
+    nob_cmd_append(cmd, BUILD_DIR"packer", "./assets/pack.txt", BUILD_DIR"assets.pack");
+    return nob_cmd_run_sync(*cmd);
+}
+
+#define LIBAV_PACKAGES "libavcodec libavformat libavutil libswscale"
+// Remembers which backend panim was last built with, switching it rebuilds panim
+#define PANIM_BACKEND_PATH BUILD_DIR"panim.backend"
+
+// The in-process encoder of --libav needs the development files of FFmpeg's libraries.
+// Returns the compiler and linker flags pkg-config gives for them, NULL when they are not installed.
+const char *libav_flags(void) {
+    FILE *pkg_config = popen("pkg-config --cflags --libs "LIBAV_PACKAGES" 2>/dev/null", "r");
+    if (pkg_config == NULL) return NULL;
+    Nob_String_Builder flags = {0};
+    char buffer[256];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pkg_config)) > 0) nob_sb_append_buf(&flags, buffer, n);
+    if (pclose(pkg_config) != 0) {
+        nob_sb_free(flags);
+        return NULL;
+    }
+    nob_sb_append_null(&flags);
+    return flags.items;
+}
+
+// A different backend than the last build or no record of it at all
+bool panim_backend_changed(const char *backend) {
+    Nob_String_Builder last = {0};
+    if (!nob_file_exists(PANIM_BACKEND_PATH) || !nob_read_entire_file(PANIM_BACKEND_PATH, &last)) return true;
+    bool changed = !nob_sv_eq(nob_sb_to_sv(last), nob_sv_from_cstr(backend));
+    nob_sb_free(last);
+    return changed;
+}
+
+// libav is the flags of libav_flags(), NULL builds panim with the ffmpeg pipe only
+bool build_panim(bool force, Nob_Cmd *cmd, const char *libav) {
     const char *output_path = BUILD_DIR"panim";
     const char *input_paths[] = {
         SRC_DIR"/panim.c",
-        SRC_DIR"/ffmpeg_linux.c"
+        SRC_DIR"/ffmpeg_linux.c",
+        SRC_DIR"/readback.c",
+        SRC_DIR"/yuv.c",
+        SRC_DIR"/hash.c",
+        SRC_DIR"/profile.c",
+        SRC_DIR"/metrics.c",
+        SRC_DIR"/qoi.c",
+        SRC_DIR"/mixer.c",
+        SRC_DIR"/wav.c",
+        SRC_DIR"/stream.c",
+        SRC_DIR"/trace.c",
+        SRC_DIR"/hud.c",
+        SRC_DIR"/watch.c",
+        SRC_DIR"/assets.c",
+        SRC_DIR"/glyphs.c",
+        SRC_DIR"/pack.c",
     };
     size_t input_paths_len = NOB_ARRAY_LEN(input_paths);
 
+    const char *backend = libav ? libav : "pipe";
     int rebuild_is_needed = nob_needs_rebuild(output_path, input_paths, input_paths_len);
     if (rebuild_is_needed < 0) return false;
+    if (libav && !rebuild_is_needed) {
+        rebuild_is_needed = nob_needs_rebuild1(output_path, SRC_DIR"/ffmpeg_libav.c");
+        if (rebuild_is_needed < 0) return false;
+    }
 
-    if (force || rebuild_is_needed) {
+    if (force || rebuild_is_needed || panim_backend_changed(backend)) {
         cmd->count = 0;
         cc(cmd);
+        if (libav) nob_cmd_append(cmd, "-DPANIM_LIBAV");
         nob_cmd_append(cmd, "-o", output_path);
         nob_da_append_many(cmd, input_paths, input_paths_len);
+        if (libav) nob_cmd_append(cmd, SRC_DIR"/ffmpeg_libav.c");
         libs(cmd);
-        return nob_cmd_run_sync(*cmd);
+        if (libav) {
+            Nob_String_View flags = nob_sv_from_cstr(libav);
+            while (flags.count > 0) {
+                Nob_String_View flag = nob_sv_trim(nob_sv_chop_by_delim(&flags, ' '));
+                if (flag.count > 0) nob_cmd_append(cmd, nob_temp_sv_to_cstr(flag));
+            }
+        }
+        if (!nob_cmd_run_sync(*cmd)) return false;
+        return nob_write_entire_file(PANIM_BACKEND_PATH, backend, strlen(backend));
     }
 
     nob_log(NOB_INFO, "%s is up-to-date", output_path);
@@ -94,10 +227,24 @@ int main(int argc, char **argv) {
     (void) program_name;
 
     bool force = false;
+    // The in-process encoder has not been checked against the pipe yet, so it is built only when asked
+    bool with_libav = false;
+    const char *only_plug = NULL;
+    bool pack = false;
     while (argc > 0) {
         const char *flag = nob_shift_args(&argc, &argv);
         if (strcmp(flag, "-f") == 0) {
             force = true;
+        } else if (strcmp(flag, "--libav") == 0) {
+            with_libav = true;
+        } else if (strcmp(flag, "--pack") == 0) {
+            pack = true;
+        } else if (strcmp(flag, "--plug") == 0) {
+            if (argc <= 0) {
+                nob_log(NOB_ERROR, "No plugin name is provided for %s", flag);
+                return 1;
+            }
+            only_plug = nob_shift_args(&argc, &argv);
         } else {
             nob_log(NOB_ERROR, "Unknown flag %s", flag);
             return 1;
@@ -107,12 +254,29 @@ int main(int argc, char **argv) {
     if (!nob_mkdir_if_not_exists(BUILD_DIR)) return 1;
 
     Nob_Cmd cmd = {0};
-    if (!build_plug_c(force, &cmd, SRC_DIR"/tm.c", BUILD_DIR"libtm.so")) return 1;
-    if (!build_plug_c(force, &cmd, SRC_DIR"/template.c", BUILD_DIR"libtemplate.so")) return 1;
-    if (!build_plug_c(force, &cmd, SRC_DIR"/squares.c", BUILD_DIR"libsquares.so")) return 1;
-    if (!build_plug_c(force, &cmd, SRC_DIR"/bezier.c", BUILD_DIR"libbezier.so")) return 1;
-    if (!build_plug_cxx(force, &cmd, SRC_DIR"/probe.cpp", BUILD_DIR"libprobe.so")) return 1;
-    if (!build_panim(force, &cmd)) return 1;
+    // Only the plugin that panim is previewing, that's how it rebuilds it on its own
+    if (only_plug) {
+        for (size_t i = 0; i < NOB_ARRAY_LEN(plugs); ++i) {
+            if (strcmp(plugs[i].name, only_plug) == 0) return build_plug(force, &cmd, plugs[i]) ? 0 : 1;
+        }
+        nob_log(NOB_ERROR, "Unknown plugin %s", only_plug);
+        return 1;
+    }
+
+    for (size_t i = 0; i < NOB_ARRAY_LEN(plugs); ++i) {
+        if (!build_plug(force, &cmd, plugs[i])) return 1;
+    }
+    const char *libav = NULL;
+    if (with_libav) {
+        libav = libav_flags();
+        if (libav == NULL) {
+            nob_log(NOB_ERROR, "libav is not found, install the development files of "LIBAV_PACKAGES);
+            return 1;
+        }
+    }
+    if (!build_panim(force, &cmd, libav)) return 1;
+    // Baking takes a while and panim works without the pack, so it's only done when asked
+    if (pack && !bake_pack(force, &cmd)) return 1;
 
     // cmd.count = 0;
     // nob_cmd_append(&cmd, BUILD_DIR"panim", BUILD_DIR"libtm.so");
@@ -0,0 +1,569 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <sys/stat.h>
+
+#include <raylib.h>
+#include <rlgl.h>
+
+#include "nob.h"
+#include "assets.h"
+#include "pack.h"
+#include "trace.h"
+
+// Decoding is mostly waiting for the disk and for zlib, a couple of threads keep up with the uploads
+#define ASSETS_LOADER_THREADS 2
+
+// The distance fields of raylib keep the edge at 0.5. The width of the smoothstep follows the
+// screen-space derivative, so the edge stays one pixel wide at any size and zoom.
+static const char *sdf_fs =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform vec4 colDiffuse;\n"
+    "out vec4 finalColor;\n"
+    "\n"
+    "void main() {\n"
+    "    float dist = texture(texture0, fragTexCoord).a - 0.5;\n"
+    "    float width = length(vec2(dFdx(dist), dFdy(dist)));\n"
+    "    float alpha = smoothstep(-width, width, dist);\n"
+    "    finalColor = vec4(fragColor.rgb, fragColor.a*alpha)*colDiffuse;\n"
+    "}\n";
+
+typedef enum {
+    ASSET_FONT,
+    ASSET_TEXTURE,
+    ASSET_WAVE,
+    ASSET_GLYPH_FONT, // Only reads the file, so it's never queued for the loader
+} Asset_Kind;
+
+typedef enum {
+    ASSET_LOADING, // Queued for the loader or decoded and waiting for the upload
+    ASSET_READY,
+    ASSET_FAILED,  // Keeps the placeholder until it's released
+} Asset_State;
+
+typedef struct Asset Asset;
+
+struct Asset {
+    Asset_Kind kind;
+    char *file_path;
+    int font_size;
+    char *codepoints; // NULL for the default characters
+    bool mipmaps;
+    int filter;
+    struct timespec mtime; // The file is loaded again when it changes
+    bool stale;            // Replaced by a newer version of the file, never handed out again
+
+    // Only touched on the main thread
+    Asset_State state;
+    size_t refs;
+
+    // What decode_asset() leaves for upload_asset(). The image carries all the mipmaps when it
+    // comes from the pack, and the glyphs and the recs go to the font as they are.
+    struct {
+        bool ok;
+        bool packed; // The pixels and the samples belong to the mapping of the pack
+        Image image;
+        GlyphInfo *glyphs;
+        Rectangle *recs;
+        int glyphs_count;
+        int glyph_padding;
+        Wave wave;
+    } decoded;
+    Asset *next; // In the queues of the loader
+
+    // Never moves, the plugins keep pointers to it from the request_*() functions
+    union {
+        Font font;
+        Texture2D texture;
+        Wave wave;
+        Glyph_Font *glyph_font;
+    };
+};
+
+static struct {
+    Asset **items;
+    size_t count;
+    size_t capacity;
+} assets = {0};
+
+static Pack *pack = NULL;
+static Shader sdf_shader = {0};
+
+typedef struct {
+    Asset *first;
+    Asset *last;
+} Asset_Queue;
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t work; // Signaled when a job is queued
+    pthread_cond_t done; // Signaled when a job is decoded
+    Asset_Queue jobs;
+    Asset_Queue decoded;
+    size_t threads;
+    size_t loading;      // Requested and not uploaded yet, only touched on the main thread
+} loader = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+static void queue_push(Asset_Queue *queue, Asset *asset) {
+    asset->next = NULL;
+    if (queue->last) queue->last->next = asset;
+    else queue->first = asset;
+    queue->last = asset;
+}
+
+static Asset *queue_pop(Asset_Queue *queue) {
+    Asset *asset = queue->first;
+    if (asset) {
+        queue->first = asset->next;
+        if (queue->first == NULL) queue->last = NULL;
+    }
+    return asset;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static struct timespec file_mtime(const char *file_path) {
+    struct stat statbuf = {0};
+    stat(file_path, &statbuf);
+    return statbuf.st_mtim;
+}
+
+static bool same_cstr(const char *a, const char *b) {
+    if (a == NULL || b == NULL) return a == b;
+    return strcmp(a, b) == 0;
+}
+
+// Takes a reference to the asset with the same key if the file did not change since it was loaded
+static Asset *find_asset(Asset_Kind kind, const char *file_path, int font_size, const char *codepoints, bool mipmaps, int filter) {
+    struct timespec mtime = file_mtime(file_path);
+    for (size_t i = 0; i < assets.count; ++i) {
+        Asset *asset = assets.items[i];
+        if (asset->stale || asset->state == ASSET_FAILED) continue;
+        if (asset->kind != kind || strcmp(asset->file_path, file_path) != 0) continue;
+        if (asset->font_size != font_size || !same_cstr(asset->codepoints, codepoints)) continue;
+        if (asset->mipmaps != mipmaps || asset->filter != filter) continue;
+        if (asset->mtime.tv_sec != mtime.tv_sec || asset->mtime.tv_nsec != mtime.tv_nsec) {
+            asset->stale = true;
+            continue;
+        }
+        asset->refs += 1;
+        return asset;
+    }
+    return NULL;
+}
+
+static Asset *new_asset(Asset key) {
+    Asset *asset = malloc(sizeof(*asset));
+    *asset = key;
+    asset->file_path = strdup(key.file_path);
+    if (key.codepoints) asset->codepoints = strdup(key.codepoints);
+    asset->mtime = file_mtime(key.file_path);
+    asset->refs = 1;
+    switch (asset->kind) {
+        case ASSET_FONT:    asset->font = GetFontDefault(); break;
+        case ASSET_TEXTURE: asset->texture = (Texture2D) {0}; break;
+        case ASSET_WAVE:    asset->wave = (Wave) {0}; break;
+        case ASSET_GLYPH_FONT: asset->glyph_font = NULL; break;
+    }
+    return asset;
+}
+
+static void free_asset(Asset *asset) {
+    if (asset->state == ASSET_READY) {
+        switch (asset->kind) {
+            case ASSET_FONT:    UnloadFont(asset->font); break;
+            case ASSET_TEXTURE: UnloadTexture(asset->texture); break;
+            case ASSET_WAVE:    if (!pack_contains(pack, asset->wave.data)) UnloadWave(asset->wave); break;
+            case ASSET_GLYPH_FONT: glyph_font_unload(asset->glyph_font); break;
+        }
+        TraceLog(LOG_INFO, "ASSETS: unloaded %s", asset->file_path);
+    }
+    free(asset->file_path);
+    free(asset->codepoints);
+    free(asset);
+}
+
+// The baked version of the asset, as long as the file did not change since it was baked
+static const Pack_Entry *find_packed(Pack_Kind kind, const char *file_path, int font_size, const char *codepoints) {
+    const Pack_Entry *entry = pack_find(pack, kind, file_path, font_size, codepoints);
+    if (entry == NULL) return NULL;
+    struct timespec mtime = file_mtime(file_path);
+    if (entry->mtime_sec != mtime.tv_sec || entry->mtime_nsec != mtime.tv_nsec) return NULL;
+    return entry;
+}
+
+static Image packed_image(const Pack_Entry *entry) {
+    return (Image) {
+        .data = (void*)pack_at(pack, entry->data),
+        .width = entry->width,
+        .height = entry->height,
+        .mipmaps = entry->mipmaps,
+        .format = entry->format,
+    };
+}
+
+static bool decode_font(Asset *asset) {
+    Pack_Font font;
+    if (!pack_rasterize_font(asset->file_path, asset->font_size, asset->codepoints, &font)) return false;
+    asset->decoded.glyphs = font.glyphs;
+    asset->decoded.recs = font.recs;
+    asset->decoded.glyphs_count = font.glyphs_count;
+    asset->decoded.glyph_padding = font.glyph_padding;
+    asset->decoded.image = font.atlas;
+    return true;
+}
+
+// The glyphs come without their images, which only ImageText() and friends need
+static bool decode_packed_font(Asset *asset, const Pack_Entry *entry) {
+    const Pack_Glyph *glyphs = pack_at(pack, entry->glyphs);
+    asset->decoded.packed = true;
+    asset->decoded.image = packed_image(entry);
+    asset->decoded.glyphs_count = entry->glyphs_count;
+    asset->decoded.glyph_padding = entry->glyph_padding;
+    asset->decoded.glyphs = calloc(entry->glyphs_count, sizeof(GlyphInfo));
+    asset->decoded.recs = malloc(entry->glyphs_count*sizeof(Rectangle));
+    for (int i = 0; i < entry->glyphs_count; ++i) {
+        asset->decoded.glyphs[i].value = glyphs[i].value;
+        asset->decoded.glyphs[i].offsetX = glyphs[i].offset_x;
+        asset->decoded.glyphs[i].offsetY = glyphs[i].offset_y;
+        asset->decoded.glyphs[i].advanceX = glyphs[i].advance_x;
+        asset->decoded.recs[i] = (Rectangle) {glyphs[i].x, glyphs[i].y, glyphs[i].width, glyphs[i].height};
+    }
+    return true;
+}
+
+// Everything that does not need the OpenGL context, so it runs on the threads of the loader.
+// The pack only has to be pointed at.
+static void decode_asset(Asset *asset) {
+    trace_begin("decode_asset");
+    bool ok = false;
+    switch (asset->kind) {
+        case ASSET_FONT: {
+            const Pack_Entry *entry = find_packed(PACK_FONT, asset->file_path, asset->font_size, asset->codepoints);
+            ok = entry ? decode_packed_font(asset, entry) : decode_font(asset);
+        } break;
+        case ASSET_TEXTURE: {
+            const Pack_Entry *entry = find_packed(PACK_TEXTURE, asset->file_path, 0, NULL);
+            asset->decoded.packed = entry != NULL;
+            asset->decoded.image = entry ? packed_image(entry) : LoadImage(asset->file_path);
+            ok = asset->decoded.image.data != NULL;
+        } break;
+        case ASSET_WAVE: {
+            const Pack_Entry *entry = find_packed(PACK_WAVE, asset->file_path, 0, NULL);
+            if (entry) {
+                // The samples are already in the format of the mixer and stay in the mapping
+                asset->decoded.packed = true;
+                asset->decoded.wave = (Wave) {
+                    .frameCount = entry->frame_count,
+                    .sampleRate = entry->sample_rate,
+                    .sampleSize = entry->sample_size,
+                    .channels = entry->channels,
+                    .data = (void*)pack_at(pack, entry->data),
+                };
+            } else {
+                asset->decoded.wave = LoadWave(asset->file_path);
+            }
+            ok = asset->decoded.wave.data != NULL;
+        } break;
+        case ASSET_GLYPH_FONT: break;
+    }
+    asset->decoded.ok = ok;
+    trace_end();
+}
+
+// The mipmaps from the pack are uploaded as they are, the rest are generated by the GPU
+static Texture2D upload_image(Asset *asset) {
+    Image *image = &asset->decoded.image;
+    Texture2D texture = {
+        .width = image->width,
+        .height = image->height,
+        .mipmaps = asset->mipmaps ? image->mipmaps : 1,
+        .format = image->format,
+    };
+    texture.id = rlLoadTexture(image->data, texture.width, texture.height, texture.format, texture.mipmaps);
+    if (asset->mipmaps && texture.mipmaps == 1) GenTextureMipmaps(&texture);
+    SetTextureFilter(texture, asset->filter);
+    if (!asset->decoded.packed) UnloadImage(*image);
+    *image = (Image) {0};
+    return texture;
+}
+
+static void upload_asset(Asset *asset) {
+    if (!asset->decoded.ok) {
+        if (asset->kind == ASSET_FONT && !asset->decoded.packed) {
+            UnloadImage(asset->decoded.image);
+            UnloadFontData(asset->decoded.glyphs, asset->decoded.glyphs_count);
+            MemFree(asset->decoded.recs);
+        }
+        TraceLog(LOG_WARNING, "ASSETS: could not load %s", asset->file_path);
+        asset->state = ASSET_FAILED;
+        return;
+    }
+
+    trace_begin("upload_asset");
+    switch (asset->kind) {
+        case ASSET_FONT:
+            asset->font = (Font) {
+                .baseSize = asset->font_size,
+                .glyphCount = asset->decoded.glyphs_count,
+                .glyphPadding = asset->decoded.glyph_padding,
+                .texture = upload_image(asset),
+                .recs = asset->decoded.recs,
+                .glyphs = asset->decoded.glyphs,
+            };
+            break;
+        case ASSET_TEXTURE:
+            asset->texture = upload_image(asset);
+            break;
+        case ASSET_WAVE:
+            asset->wave = asset->decoded.wave;
+            break;
+        case ASSET_GLYPH_FONT: break;
+    }
+    trace_end();
+    asset->state = ASSET_READY;
+}
+
+static void *loader_thread(void *arg) {
+    (void)arg;
+    trace_thread_name("asset loader");
+    pthread_mutex_lock(&loader.mutex);
+    for (;;) {
+        Asset *asset = queue_pop(&loader.jobs);
+        if (asset == NULL) {
+            pthread_cond_wait(&loader.work, &loader.mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&loader.mutex);
+        decode_asset(asset);
+        pthread_mutex_lock(&loader.mutex);
+        queue_push(&loader.decoded, asset);
+        pthread_cond_broadcast(&loader.done);
+    }
+    return NULL;
+}
+
+// Uploads the next decoded asset, waiting for the loader if `wait`. Returns false when there was none.
+static bool upload_next(bool wait) {
+    pthread_mutex_lock(&loader.mutex);
+    while (wait && loader.decoded.first == NULL) pthread_cond_wait(&loader.done, &loader.mutex);
+    Asset *asset = queue_pop(&loader.decoded);
+    pthread_mutex_unlock(&loader.mutex);
+    if (asset == NULL) return false;
+    upload_asset(asset);
+    loader.loading -= 1;
+    return true;
+}
+
+static void wait_for(Asset *asset) {
+    while (asset->state == ASSET_LOADING) upload_next(true);
+}
+
+// Decodes and uploads the asset right away. Frees it and returns NULL when it fails.
+static Asset *load_now(Asset *asset) {
+    decode_asset(asset);
+    upload_asset(asset);
+    if (asset->state == ASSET_FAILED) {
+        free_asset(asset);
+        return NULL;
+    }
+    nob_da_append(&assets, asset);
+    return asset;
+}
+
+// The threads only start with the first request, so the renders that never ask for them don't pay for them
+static void request(Asset *asset) {
+    if (loader.threads == 0) {
+        for (size_t i = 0; i < ASSETS_LOADER_THREADS; ++i) {
+            pthread_t thread;
+            if (pthread_create(&thread, NULL, loader_thread, NULL) != 0) break;
+            pthread_detach(thread);
+            loader.threads += 1;
+        }
+    }
+
+    nob_da_append(&assets, asset);
+    if (loader.threads == 0) {
+        decode_asset(asset);
+        upload_asset(asset);
+        return;
+    }
+    asset->state = ASSET_LOADING;
+    loader.loading += 1;
+    pthread_mutex_lock(&loader.mutex);
+    queue_push(&loader.jobs, asset);
+    pthread_cond_signal(&loader.work);
+    pthread_mutex_unlock(&loader.mutex);
+}
+
+static Font assets_load_font(const char *file_path, int font_size, const char *codepoints, bool mipmaps, int filter) {
+    Asset *asset = find_asset(ASSET_FONT, file_path, font_size, codepoints, mipmaps, filter);
+    if (asset) {
+        wait_for(asset);
+        return asset->font;
+    }
+    asset = load_now(new_asset((Asset) {
+        .kind = ASSET_FONT,
+        .file_path = (char*)file_path,
+        .font_size = font_size,
+        .codepoints = (char*)codepoints,
+        .mipmaps = mipmaps,
+        .filter = filter,
+    }));
+    return asset ? asset->font : GetFontDefault();
+}
+
+static Shader assets_sdf_shader(void) {
+    if (sdf_shader.id == 0) {
+        sdf_shader = LoadShaderFromMemory(NULL, sdf_fs);
+        if (sdf_shader.id == rlGetShaderIdDefault()) TraceLog(LOG_WARNING, "ASSETS: could not compile the distance field shader");
+    }
+    return sdf_shader;
+}
+
+static const Texture2D *assets_request_texture(const char *file_path, bool mipmaps, int filter) {
+    Asset *asset = find_asset(ASSET_TEXTURE, file_path, 0, NULL, mipmaps, filter);
+    if (asset) return &asset->texture;
+    asset = new_asset((Asset) {
+        .kind = ASSET_TEXTURE,
+        .file_path = (char*)file_path,
+        .mipmaps = mipmaps,
+        .filter = filter,
+    });
+    request(asset);
+    return &asset->texture;
+}
+
+static const Wave *assets_request_wave(const char *file_path) {
+    Asset *asset = find_asset(ASSET_WAVE, file_path, 0, NULL, false, 0);
+    if (asset) return &asset->wave;
+    asset = new_asset((Asset) {
+        .kind = ASSET_WAVE,
+        .file_path = (char*)file_path,
+    });
+    request(asset);
+    return &asset->wave;
+}
+
+// Drops a reference. The fonts that did not come from the cache are unloaded right away.
+static void assets_unload_font(Font font) {
+    for (size_t i = 0; i < assets.count; ++i) {
+        Asset *asset = assets.items[i];
+        if (asset->kind != ASSET_FONT || asset->state != ASSET_READY || asset->refs == 0) continue;
+        if (asset->font.texture.id == font.texture.id) {
+            asset->refs -= 1;
+            return;
+        }
+    }
+    UnloadFont(font);
+}
+
+static void assets_release(const void *requested) {
+    if (requested == NULL) return;
+    for (size_t i = 0; i < assets.count; ++i) {
+        Asset *asset = assets.items[i];
+        if ((const void*)&asset->font == requested) {
+            if (asset->refs > 0) asset->refs -= 1;
+            return;
+        }
+    }
+}
+
+static Glyph_Font *assets_load_glyph_font(const char *file_path, int font_size) {
+    Asset *asset = find_asset(ASSET_GLYPH_FONT, file_path, font_size, NULL, false, TEXTURE_FILTER_BILINEAR);
+    if (asset) return asset->glyph_font;
+
+    // The glyphs are rasterized as they are drawn, so there is nothing to decode in the background
+    Glyph_Font *glyph_font = glyph_font_load(file_path, font_size);
+    if (glyph_font == NULL) {
+        TraceLog(LOG_WARNING, "ASSETS: could not load %s", file_path);
+        return NULL;
+    }
+    asset = new_asset((Asset) {
+        .kind = ASSET_GLYPH_FONT,
+        .file_path = (char*)file_path,
+        .font_size = font_size,
+        .filter = TEXTURE_FILTER_BILINEAR,
+    });
+    asset->state = ASSET_READY;
+    asset->glyph_font = glyph_font;
+    nob_da_append(&assets, asset);
+    return glyph_font;
+}
+
+static void assets_unload_glyph_font(Glyph_Font *glyph_font) {
+    if (glyph_font == NULL) return;
+    for (size_t i = 0; i < assets.count; ++i) {
+        Asset *asset = assets.items[i];
+        if (asset->kind == ASSET_GLYPH_FONT && asset->glyph_font == glyph_font) {
+            if (asset->refs > 0) asset->refs -= 1;
+            return;
+        }
+    }
+    glyph_font_unload(glyph_font);
+}
+
+static void assets_draw_glyph_text(Glyph_Font *glyph_font, const char *text, Vector2 position, float size, float spacing, Color color) {
+    if (glyph_font == NULL) {
+        glyph_font_draw(NULL, text, position, size, spacing, color);
+        return;
+    }
+    BeginShaderMode(assets_sdf_shader());
+    glyph_font_draw(glyph_font, text, position, size, spacing, color);
+    EndShaderMode();
+}
+
+const Asset_Funcs asset_funcs = {
+    .load_font = assets_load_font,
+    .unload_font = assets_unload_font,
+    .request_texture = assets_request_texture,
+    .request_wave = assets_request_wave,
+    .release = assets_release,
+    .load_glyph_font = assets_load_glyph_font,
+    .unload_glyph_font = assets_unload_glyph_font,
+    .measure_glyph_text = glyph_font_measure,
+    .draw_glyph_text = assets_draw_glyph_text,
+};
+
+void assets_update(double budget) {
+    double start = now();
+    while (loader.loading > 0 && upload_next(false)) {
+        if (now() - start >= budget) break;
+    }
+}
+
+void assets_wait(void) {
+    while (loader.loading > 0) upload_next(true);
+}
+
+void assets_collect(void) {
+    size_t kept = 0;
+    for (size_t i = 0; i < assets.count; ++i) {
+        Asset *asset = assets.items[i];
+        // The loader may still be writing into the ones that are loading
+        if (asset->refs > 0 || asset->state == ASSET_LOADING) {
+            assets.items[kept++] = asset;
+            continue;
+        }
+        free_asset(asset);
+    }
+    assets.count = kept;
+}
+
+bool assets_open_pack(const char *file_path) {
+    pack = pack_open(file_path);
+    return pack != NULL;
+}
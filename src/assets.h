@@ -0,0 +1,53 @@
+#ifndef ASSETS_H_
+#define ASSETS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <raylib.h>
+
+#include "glyphs.h"
+
+// Assets owned by the host and shared with the plugins through plug_set_assets. They are reference
+// counted and keyed by the path and the load parameters. An asset that nobody holds anymore is
+// only freed by assets_collect(), so a plugin that unloads everything in plug_pre_reload() gets
+// it all back instantly in plug_post_reload(). A file that changed on disk is loaded again.
+//
+// load_font() blocks until the font is ready. The request_*() functions return right away and the
+// threads of the host decode the file in the background, while the main thread uploads a few of
+// the decoded assets every frame.
+
+typedef struct {
+    // LoadFontEx() of the characters of the UTF-8 `codepoints`, or of the default ones when it's NULL
+    Font (*load_font)(const char *file_path, int font_size, const char *codepoints, bool mipmaps, int filter);
+    void (*unload_font)(Font font);
+
+    // The asset behind the pointer is a placeholder until it's uploaded: a texture with id 0 that
+    // draws nothing or a wave without samples that plays nothing. It stays at the same place until
+    // it's released, so keep the pointer and look through it when drawing.
+    const Texture2D *(*request_texture)(const char *file_path, bool mipmaps, int filter);
+    const Wave *(*request_wave)(const char *file_path);
+    // Drops an asset of the request_*() functions
+    void (*release)(const void *asset);
+    // A font without a fixed set of characters, see glyphs.h. Loaded right away, since only the file
+    // is read, and NULL when it can't be. The draw takes care of the distance field shader.
+    Glyph_Font *(*load_glyph_font)(const char *file_path, int font_size);
+    void (*unload_glyph_font)(Glyph_Font *font);
+    Vector2 (*measure_glyph_text)(Glyph_Font *font, const char *text, float size, float spacing);
+    void (*draw_glyph_text)(Glyph_Font *font, const char *text, Vector2 position, float size, float spacing, Color color);
+} Asset_Funcs;
+
+extern const Asset_Funcs asset_funcs;
+
+// Takes the assets baked into the pack by `./nob --pack` from there instead of decoding the files.
+// The pack stays mapped until the end. Returns false when there is no valid pack.
+bool assets_open_pack(const char *file_path);
+// Uploads the assets the loader finished decoding on the main thread. Stops when `budget`
+// seconds have passed, but always uploads at least one, so the loading keeps moving.
+void assets_update(double budget);
+// Uploads all the requested assets, waiting for the loader to decode them. The renders do this
+// before every frame, so they never see a placeholder.
+void assets_wait(void);
+// Frees the assets that are not held by anybody anymore. Needs the OpenGL context.
+void assets_collect(void);
+
+#endif // ASSETS_H_
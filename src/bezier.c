@@ -34,15 +34,14 @@ typedef struct {
 } Plug;
 
 static Plug *p;
+static const Asset_Funcs *assets = NULL;
 
 static void load_assets(void) {
-    p->font = LoadFontEx("./assets/fonts/iosevka-regular.ttf", FONT_SIZE, NULL, 0);
-    GenTextureMipmaps(&p->font.texture);
-    SetTextureFilter(p->font.texture, TEXTURE_FILTER_BILINEAR);
+    p->font = assets->load_font("./assets/fonts/iosevka-regular.ttf", FONT_SIZE, NULL, true, TEXTURE_FILTER_BILINEAR);
 }
 
 static void unload_assets(void) {
-    UnloadFont(p->font);
+    assets->unload_font(p->font);
 }
 
 static bool save_curve_to_file(const char *file_path, Nob_String_Builder *sb, Vector2 curve[COUNT_NODES]) {
@@ -119,6 +118,10 @@ void plug_reset(void) {
     }
 }
 
+void plug_set_assets(const Asset_Funcs *funcs) {
+    assets = funcs;
+}
+
 void plug_init(void) {
     p = malloc(sizeof(*p));
     assert(p != NULL);
@@ -146,6 +149,8 @@ void plug_post_reload(void *state) {
 }
 
 void plug_update(Env env) {
+    if (env.no_draw) return;
+
     Color background_color = ColorFromHSV(0, 0, 0.05);
     Color foreground_color = ColorFromHSV(0, 0, 0.95);
 
@@ -2,15 +2,39 @@
 #define ENV_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <raylib.h>
 
+#include "trace.h"
+#include "assets.h"
+
 typedef struct {
     float delta_time;
     float screen_width;
     float screen_height;
     bool rendering;
+    // Only advance the animation, nothing is going to see what is drawn. Set when the host
+    // renders just the sound or seeks through the animation.
+    bool no_draw;
     void (*play_sound)(Sound sound, Wave wave);
+    // Plays the wave on top of whatever is already playing. The wave must stay loaded until
+    // it finishes. `pan` goes from -1.0 (left) to 1.0 (right).
+    void (*play_wave)(Wave wave, float gain, float pan);
+    // Plays a long 16 bit PCM .wav of 44100hz straight from the disk, like narration or music,
+    // without loading it whole. The host opens and closes the file.
+    void (*play_stream)(const char *file_path, float gain, float pan);
+    // Marks the sections of the frame in the trace of --trace. Never NULL, does nothing without --trace.
+    const Trace_Funcs *trace;
     // void *params;
 } Env;
 
+// What the animation reports about itself to the performance HUD of the preview, see plug_stats
+typedef struct {
+    size_t arena_bytes;    // Allocated from all the arenas of the plugin
+    size_t arena_capacity; // Reserved by their regions
+    size_t arena_regions;
+    size_t tasks_updated;  // Tasks updated since the previous report
+    size_t tasks_running;  // The updated tasks that did not finish yet
+} Plug_Stats;
+
 #endif // ENV_H
\ No newline at end of file
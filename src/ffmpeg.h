@@ -6,9 +6,59 @@
 
 typedef struct FFMPEG FFMPEG;
 
+typedef enum {
+    FFMPEG_PIXEL_FORMAT_RGBA,    // Bottom-up RGBA rows as read back from OpenGL, see ffmpeg_send_frame_flipped()
+    FFMPEG_PIXEL_FORMAT_YUV420P, // Top-down planar I420 as produced by yuv_convert(), see ffmpeg_send_frame()
+} FFMPEG_Pixel_Format;
+
+typedef struct {
+    size_t width;
+    size_t height;
+    size_t fps;
+    FFMPEG_Pixel_Format pixel_format;
+    // The encoder settings. A NULL codec means libx264, and the encoder targets the
+    // bitrate when crf is 0, falling back to 2500k when there is no bitrate either.
+    const char *codec;
+    const char *preset;
+    size_t crf;
+    const char *bitrate;
+    // Where the verbose output of ffmpeg goes. NULL leaves it on the terminal.
+    const char *log_path;
+    // Interleaved s16le samples sent with ffmpeg_send_sound_samples() are muxed into
+    // the same file when both are set. Leave them at 0 for a silent video.
+    size_t sound_sample_rate;
+    size_t sound_channels;
+} FFMPEG_Video_Params;
+
+typedef enum {
+    FFMPEG_IMAGE_FORMAT_QOI,
+    FFMPEG_IMAGE_FORMAT_PNG,
+    FFMPEG_IMAGE_FORMAT_RAW, // Top-down RGBA pixels without any header
+} FFMPEG_Image_Format;
+
+typedef struct {
+    size_t width;
+    size_t height;
+    FFMPEG_Image_Format format;
+    size_t threads;     // Amount of encoding workers
+    size_t first_frame; // Number of the first file of the sequence
+} FFMPEG_Image_Params;
+
 FFMPEG *ffmpeg_start_rendering_video(const char *output_path, size_t width, size_t height, size_t fps);
-FFMPEG *ffmpeg_start_rendering_audio(const char *output_path);
+FFMPEG *ffmpeg_start_rendering_video_ex(const char *output_path, FFMPEG_Video_Params params);
+// Renders 44100hz stereo s16le samples. A .wav is written without running ffmpeg and has no log.
+FFMPEG *ffmpeg_start_rendering_audio(const char *output_path, const char *log_path);
+// Writes every frame into its own file instead of piping them into ffmpeg. path_pattern is a printf
+// pattern of the frame number like "frames/%05d.qoi". Only takes the frames of ffmpeg_send_frame_flipped().
+FFMPEG *ffmpeg_start_rendering_images(const char *path_pattern, FFMPEG_Image_Params params);
 bool ffmpeg_send_frame_flipped(FFMPEG *ffmpeg, void *data, size_t width, size_t height);
+bool ffmpeg_send_frame(FFMPEG *ffmpeg, void *data);
+// Sends the previous frame once more without copying it again, e.g. when the animation holds still.
+// The raw frames of the ffmpeg pipe carry no timestamps, so the pipe writes the previous frame again and
+// ffmpeg encodes it like any other. libav does not encode it, the previous frame stays on the screen longer,
+// and a hold at the end is encoded once more when the rendering ends so the video keeps its duration.
+// An image sequence links the file of the previous frame.
+bool ffmpeg_repeat_frame(FFMPEG *ffmpeg);
 bool ffmpeg_send_sound_samples(FFMPEG *ffmpeg, void *data, size_t size);
 bool ffmpeg_end_rendering(FFMPEG *ffmpeg, bool cancel);
 
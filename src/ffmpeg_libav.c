@@ -0,0 +1,353 @@
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+
+#include <raylib.h>
+#include "ffmpeg_libav.h"
+
+// AVCodecContext.ch_layout replaced the channels/channel_layout pair in FFmpeg 5.1
+#define LIBAV_HAS_CH_LAYOUT (LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 24, 100))
+
+struct FFMPEG_Libav {
+    AVFormatContext *format;
+    AVPacket *packet;
+    bool failed;
+
+    AVCodecContext *video;
+    AVStream *video_stream;
+    AVFrame *frame;          // The last frame, the repeats only make it last longer
+    struct SwsContext *sws;  // RGBA -> I420, NULL when the frames already come as I420
+    FFMPEG_Pixel_Format pixel_format;
+    size_t width;
+    size_t height;
+    int64_t video_pts;
+    bool video_held;         // The last frame is repeated up to video_pts, see ffmpeg_libav_repeat_frame()
+
+    // The sound comes in video frames worth of samples, while the encoder wants its own frame size
+    AVCodecContext *audio;
+    AVStream *audio_stream;
+    AVFrame *audio_frame;
+    int audio_filled;       // Samples already in audio_frame
+    size_t audio_channels;
+    int64_t audio_pts;
+};
+
+static FILE *libav_log = NULL;
+
+static void libav_log_callback(void *avcl, int level, const char *fmt, va_list args) {
+    if (level > av_log_get_level()) return;
+    static int print_prefix = 1;
+    char line[1024];
+    av_log_format_line(avcl, level, fmt, args, line, sizeof(line), &print_prefix);
+    fputs(line, libav_log);
+}
+
+// "2500k", "4M" or plain bits per second
+static int64_t parse_bitrate(const char *bitrate) {
+    char *end = NULL;
+    double value = strtod(bitrate, &end);
+    if (*end == 'k' || *end == 'K') value *= 1e3;
+    if (*end == 'm' || *end == 'M') value *= 1e6;
+    return value;
+}
+
+static bool write_packets(FFMPEG_Libav *libav, AVCodecContext *ctx, AVStream *stream) {
+    for (;;) {
+        int ret = avcodec_receive_packet(ctx, libav->packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return true;
+        if (ret < 0) {
+            TraceLog(LOG_ERROR, "LIBAV: could not receive a packet from the encoder: %s", av_err2str(ret));
+            return false;
+        }
+        av_packet_rescale_ts(libav->packet, ctx->time_base, stream->time_base);
+        libav->packet->stream_index = stream->index;
+        ret = av_interleaved_write_frame(libav->format, libav->packet);
+        if (ret < 0) {
+            TraceLog(LOG_ERROR, "LIBAV: could not write a packet: %s", av_err2str(ret));
+            return false;
+        }
+    }
+}
+
+// frame is NULL to flush the encoder
+static bool encode(FFMPEG_Libav *libav, AVCodecContext *ctx, AVStream *stream, AVFrame *frame) {
+    if (libav->failed) return false;
+    int ret = avcodec_send_frame(ctx, frame);
+    if (ret < 0) {
+        TraceLog(LOG_ERROR, "LIBAV: could not send a frame to the encoder: %s", av_err2str(ret));
+        libav->failed = true;
+        return false;
+    }
+    if (!write_packets(libav, ctx, stream)) {
+        libav->failed = true;
+        return false;
+    }
+    return true;
+}
+
+static AVStream *add_stream(FFMPEG_Libav *libav, AVCodecContext *ctx) {
+    AVStream *stream = avformat_new_stream(libav->format, NULL);
+    if (stream == NULL) return NULL;
+    if (avcodec_parameters_from_context(stream->codecpar, ctx) < 0) return NULL;
+    stream->time_base = ctx->time_base;
+    return stream;
+}
+
+static bool open_video(FFMPEG_Libav *libav, FFMPEG_Video_Params params) {
+    const char *codec_name = params.codec ? params.codec : "libx264";
+    const AVCodec *codec = avcodec_find_encoder_by_name(codec_name);
+    if (codec == NULL) {
+        TraceLog(LOG_WARNING, "LIBAV: there is no %s encoder", codec_name);
+        return false;
+    }
+
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    assert(ctx != NULL && "Buy MORE RAM lol!!");
+    libav->video = ctx;
+    ctx->width = params.width;
+    ctx->height = params.height;
+    ctx->time_base = (AVRational) {1, params.fps};
+    ctx->framerate = (AVRational) {params.fps, 1};
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    if (params.preset) av_opt_set(ctx->priv_data, "preset", params.preset, 0);
+    if (params.crf > 0) {
+        char crf[32];
+        snprintf(crf, sizeof(crf), "%zu", params.crf);
+        av_opt_set(ctx->priv_data, "crf", crf, 0);
+    } else {
+        ctx->bit_rate = parse_bitrate(params.bitrate ? params.bitrate : "2500k");
+    }
+    if (libav->format->oformat->flags & AVFMT_GLOBALHEADER) ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    int ret = avcodec_open2(ctx, codec, NULL);
+    if (ret < 0) {
+        TraceLog(LOG_WARNING, "LIBAV: could not open the %s encoder: %s", codec_name, av_err2str(ret));
+        return false;
+    }
+    libav->video_stream = add_stream(libav, ctx);
+    if (libav->video_stream == NULL) return false;
+
+    libav->frame = av_frame_alloc();
+    assert(libav->frame != NULL && "Buy MORE RAM lol!!");
+    libav->frame->format = ctx->pix_fmt;
+    libav->frame->width = ctx->width;
+    libav->frame->height = ctx->height;
+    if (av_frame_get_buffer(libav->frame, 0) < 0) return false;
+
+    if (params.pixel_format == FFMPEG_PIXEL_FORMAT_RGBA) {
+        libav->sws = sws_getContext(params.width, params.height, AV_PIX_FMT_RGBA,
+                                    params.width, params.height, AV_PIX_FMT_YUV420P,
+                                    SWS_BILINEAR, NULL, NULL, NULL);
+        if (libav->sws == NULL) return false;
+    }
+    return true;
+}
+
+static bool open_audio(FFMPEG_Libav *libav, FFMPEG_Video_Params params) {
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+    if (codec == NULL) {
+        TraceLog(LOG_WARNING, "LIBAV: there is no AAC encoder");
+        return false;
+    }
+
+    AVCodecContext *ctx = avcodec_alloc_context3(codec);
+    assert(ctx != NULL && "Buy MORE RAM lol!!");
+    libav->audio = ctx;
+    libav->audio_channels = params.sound_channels;
+    ctx->sample_fmt = AV_SAMPLE_FMT_FLTP;
+    ctx->sample_rate = params.sound_sample_rate;
+    ctx->bit_rate = 200000;
+    ctx->time_base = (AVRational) {1, params.sound_sample_rate};
+#if LIBAV_HAS_CH_LAYOUT
+    av_channel_layout_default(&ctx->ch_layout, params.sound_channels);
+#else
+    ctx->channels = params.sound_channels;
+    ctx->channel_layout = av_get_default_channel_layout(params.sound_channels);
+#endif
+    if (libav->format->oformat->flags & AVFMT_GLOBALHEADER) ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    int ret = avcodec_open2(ctx, codec, NULL);
+    if (ret < 0) {
+        TraceLog(LOG_WARNING, "LIBAV: could not open the AAC encoder: %s", av_err2str(ret));
+        return false;
+    }
+    libav->audio_stream = add_stream(libav, ctx);
+    if (libav->audio_stream == NULL) return false;
+
+    AVFrame *frame = av_frame_alloc();
+    assert(frame != NULL && "Buy MORE RAM lol!!");
+    libav->audio_frame = frame;
+    frame->format = ctx->sample_fmt;
+    frame->sample_rate = ctx->sample_rate;
+    frame->nb_samples = ctx->frame_size > 0 ? ctx->frame_size : 1024;
+#if LIBAV_HAS_CH_LAYOUT
+    av_channel_layout_copy(&frame->ch_layout, &ctx->ch_layout);
+#else
+    frame->channels = ctx->channels;
+    frame->channel_layout = ctx->channel_layout;
+#endif
+    return av_frame_get_buffer(frame, 0) >= 0;
+}
+
+static void libav_free(FFMPEG_Libav *libav) {
+    sws_freeContext(libav->sws);
+    av_frame_free(&libav->frame);
+    av_frame_free(&libav->audio_frame);
+    avcodec_free_context(&libav->video);
+    avcodec_free_context(&libav->audio);
+    av_packet_free(&libav->packet);
+    if (libav->format) {
+        if (!(libav->format->oformat->flags & AVFMT_NOFILE)) avio_closep(&libav->format->pb);
+        avformat_free_context(libav->format);
+    }
+    free(libav);
+
+    if (libav_log) {
+        av_log_set_callback(av_log_default_callback);
+        fclose(libav_log);
+        libav_log = NULL;
+    }
+}
+
+FFMPEG_Libav *ffmpeg_libav_start(const char *output_path, FFMPEG_Video_Params params) {
+    FFMPEG_Libav *libav = malloc(sizeof(FFMPEG_Libav));
+    assert(libav != NULL && "Buy MORE RAM lol!!");
+    memset(libav, 0, sizeof(*libav));
+    libav->pixel_format = params.pixel_format;
+    libav->width = params.width;
+    libav->height = params.height;
+
+    if (params.log_path) {
+        libav_log = fopen(params.log_path, "w");
+        if (libav_log) {
+            av_log_set_level(AV_LOG_VERBOSE);
+            av_log_set_callback(libav_log_callback);
+        }
+    }
+
+    int ret = avformat_alloc_output_context2(&libav->format, NULL, NULL, output_path);
+    if (ret < 0) {
+        TraceLog(LOG_WARNING, "LIBAV: could not pick a container for %s: %s", output_path, av_err2str(ret));
+        libav_free(libav);
+        return NULL;
+    }
+    libav->packet = av_packet_alloc();
+    assert(libav->packet != NULL && "Buy MORE RAM lol!!");
+
+    bool with_sound = params.sound_sample_rate > 0 && params.sound_channels > 0;
+    if (!open_video(libav, params) || (with_sound && !open_audio(libav, params))) {
+        libav_free(libav);
+        return NULL;
+    }
+
+    if (!(libav->format->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&libav->format->pb, output_path, AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            TraceLog(LOG_ERROR, "LIBAV: could not open %s: %s", output_path, av_err2str(ret));
+            libav_free(libav);
+            return NULL;
+        }
+    }
+    ret = avformat_write_header(libav->format, NULL);
+    if (ret < 0) {
+        TraceLog(LOG_ERROR, "LIBAV: could not write the header of %s: %s", output_path, av_err2str(ret));
+        libav_free(libav);
+        return NULL;
+    }
+    return libav;
+}
+
+bool ffmpeg_libav_send_frame(FFMPEG_Libav *libav, const void *data) {
+    AVFrame *frame = libav->frame;
+    // The encoder may still hold a reference to the previous frame
+    if (av_frame_make_writable(frame) < 0) return false;
+
+    switch (libav->pixel_format) {
+        case FFMPEG_PIXEL_FORMAT_RGBA: {
+            // Start at the last row and walk up, since the rows come bottom-up from OpenGL
+            int stride = libav->width*4;
+            const uint8_t *src[1] = { (const uint8_t*)data + (libav->height - 1)*stride };
+            int src_stride[1] = { -stride };
+            sws_scale(libav->sws, src, src_stride, 0, libav->height, frame->data, frame->linesize);
+        } break;
+        case FFMPEG_PIXEL_FORMAT_YUV420P: {
+            uint8_t *planes[4];
+            int linesizes[4];
+            av_image_fill_arrays(planes, linesizes, data, AV_PIX_FMT_YUV420P, libav->width, libav->height, 1);
+            av_image_copy(frame->data, frame->linesize, (const uint8_t **)planes, linesizes, AV_PIX_FMT_YUV420P, libav->width, libav->height);
+        } break;
+        default: assert(0 && "Unreachable");
+    }
+
+    frame->pts = libav->video_pts++;
+    libav->video_held = false;
+    return encode(libav, libav->video, libav->video_stream, frame);
+}
+
+// A repeat only moves the timestamp of the next frame, so the previous one stays on the screen
+// longer and x264 never sees it again. The container ends up with a variable frame rate.
+bool ffmpeg_libav_repeat_frame(FFMPEG_Libav *libav) {
+    libav->video_pts += 1;
+    libav->video_held = true;
+    return !libav->failed;
+}
+
+static bool flush_audio_frame(FFMPEG_Libav *libav) {
+    AVFrame *frame = libav->audio_frame;
+    int nb_samples = frame->nb_samples;
+    frame->nb_samples = libav->audio_filled;
+    frame->pts = libav->audio_pts;
+    libav->audio_pts += libav->audio_filled;
+    libav->audio_filled = 0;
+    bool ok = encode(libav, libav->audio, libav->audio_stream, frame);
+    frame->nb_samples = nb_samples;
+    return ok;
+}
+
+bool ffmpeg_libav_send_sound_samples(FFMPEG_Libav *libav, const void *data, size_t size) {
+    assert(libav->audio != NULL && "The rendering was started without sound");
+    const int16_t *samples = data;
+    size_t count = size/(sizeof(int16_t)*libav->audio_channels);
+    AVFrame *frame = libav->audio_frame;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (libav->audio_filled == 0 && av_frame_make_writable(frame) < 0) return false;
+        for (size_t c = 0; c < libav->audio_channels; ++c) {
+            ((float*)frame->data[c])[libav->audio_filled] = samples[i*libav->audio_channels + c]/32768.0f;
+        }
+        libav->audio_filled += 1;
+        if (libav->audio_filled == frame->nb_samples && !flush_audio_frame(libav)) return false;
+    }
+    return true;
+}
+
+bool ffmpeg_libav_end(FFMPEG_Libav *libav, bool cancel) {
+    bool ok = !libav->failed;
+    if (!cancel && ok) {
+        if (libav->audio && libav->audio_filled > 0) ok = flush_audio_frame(libav);
+        // Without a frame at the last timestamp the video would end where the held frame started
+        if (libav->video_held) {
+            libav->frame->pts = libav->video_pts - 1;
+            ok = ok && encode(libav, libav->video, libav->video_stream, libav->frame);
+        }
+        ok = ok && encode(libav, libav->video, libav->video_stream, NULL);
+        if (libav->audio) ok = ok && encode(libav, libav->audio, libav->audio_stream, NULL);
+        if (ok) {
+            int ret = av_write_trailer(libav->format);
+            if (ret < 0) {
+                TraceLog(LOG_ERROR, "LIBAV: could not write the trailer: %s", av_err2str(ret));
+                ok = false;
+            }
+        }
+    }
+    libav_free(libav);
+    return ok;
+}
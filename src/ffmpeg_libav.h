@@ -0,0 +1,22 @@
+#ifndef FFMPEG_LIBAV_H_
+#define FFMPEG_LIBAV_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "ffmpeg.h"
+
+// In-process encoding through libavcodec/libavformat. Only compiled in when nob.c finds the
+// libraries (PANIM_LIBAV); ffmpeg_linux.c hands the videos over to it and falls back to
+// piping into the ffmpeg binary when it's not there or can't open the encoder.
+
+typedef struct FFMPEG_Libav FFMPEG_Libav;
+
+FFMPEG_Libav *ffmpeg_libav_start(const char *output_path, FFMPEG_Video_Params params);
+// data is in params.pixel_format: bottom-up RGBA rows or top-down I420 planes
+bool ffmpeg_libav_send_frame(FFMPEG_Libav *libav, const void *data);
+bool ffmpeg_libav_repeat_frame(FFMPEG_Libav *libav);
+// Interleaved s16le samples
+bool ffmpeg_libav_send_sound_samples(FFMPEG_Libav *libav, const void *data, size_t size);
+bool ffmpeg_libav_end(FFMPEG_Libav *libav, bool cancel);
+
+#endif // FFMPEG_LIBAV_H_
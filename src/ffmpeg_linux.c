@@ -1,34 +1,330 @@
+#define _GNU_SOURCE // F_SETPIPE_SZ and IOV_MAX
+
 #include <assert.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h> // Include for strerror
+#include <stdatomic.h>
+#include <limits.h>
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
 #include <signal.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 #include <raylib.h>
+#include "nob.h"
 #include "ffmpeg.h"
+#include "qoi.h"
+#include "wav.h"
+#include "trace.h"
+#ifdef PANIM_LIBAV
+#include "ffmpeg_libav.h"
+#endif // PANIM_LIBAV
 
 #define READ_END 0
 #define WRITE_END 1
+// The file descriptor ffmpeg reads the sound samples from when they are muxed with the video
+#define SOUND_FILENO 3
+
+// Amount of recycled frame buffers between the render thread and the writer thread.
+// When all of them are taken the render thread blocks until ffmpeg catches up.
+#define FFMPEG_QUEUE_CAPACITY 4
+// Every image worker only needs a frame to encode and one being filled in by the render thread
+#define FFMPEG_IMAGE_QUEUE_CAPACITY 2
+// Requested capacity of the pipe into ffmpeg. 1MB is the default /proc/sys/fs/pipe-max-size.
+#define FFMPEG_PIPE_SIZE (1024*1024)
+
+typedef struct {
+    void *data;
+    size_t size; // 0 means the end of the stream
+    bool repeat; // Send the previous frame once more instead of this one
+    size_t frame; // Number of the file of an image sequence
+    // Rows of data in the bottom-up order, so the whole frame goes out flipped with writev()
+    struct iovec *iov;
+    size_t iov_count;
+} FFMPEG_Slot;
+
+// Single-producer, single-consumer ring of slots. The head is only moved by the
+// render thread and the tail only by the writer thread, so the slots need no lock.
+// The semaphores are only there to park a side when the ring is full or empty.
+typedef struct {
+    FFMPEG_Slot slots[FFMPEG_QUEUE_CAPACITY];
+    size_t capacity; // Amount of the slots in use
+    atomic_size_t head;
+    atomic_size_t tail;
+    sem_t items;
+    sem_t space;
+} FFMPEG_Queue;
 
 struct FFMPEG {
     int pipe;
     pid_t pid;
+    char *log_path; // Owned copy, NULL when ffmpeg writes into the terminal
+    int sound_pipe; // Where ffmpeg_send_sound_samples() writes to. Same as pipe for audio-only rendering
+
+    // Video only
+    FFMPEG_Pixel_Format pixel_format;
+    bool threaded;
+    pthread_t writer;
+    FFMPEG_Queue queue;
+    size_t frame_size;
+    atomic_bool failed;
+    // The most recently written frame. Only the writer touches it and swaps it with the
+    // slots it consumes, so repeating a frame costs neither a copy nor a render.
+    FFMPEG_Slot last;
+
+    // Image sequence only
+    char *image_pattern;
+    FFMPEG_Image_Params image_params;
+    struct FFMPEG_Image_Worker *image_workers;
+    size_t image_frames; // Amount of frames handed out to the workers so far
+    size_t image_worker; // The worker that got the last frame that is not a repeat
+
+    // A .wav is written directly, there is nothing for ffmpeg to encode
+    Wav_Writer *wav;
+
+#ifdef PANIM_LIBAV
+    // Encoding in-process, no child and no pipes
+    FFMPEG_Libav *libav;
+#endif // PANIM_LIBAV
 };
 
+// Encodes and writes its share of the frames of an image sequence. Every worker has its
+// own queue, so the frames are handed out round-robin without any contention.
+typedef struct FFMPEG_Image_Worker {
+    FFMPEG *ffmpeg;
+    pthread_t thread;
+    FFMPEG_Queue queue;
+    size_t last_frame; // The last file written by this worker, the repeats are linked to it
+    uint8_t *scratch;  // Top-down copy of the frame for the PNG encoder
+} FFMPEG_Image_Worker;
+
+static void iov_flipped(struct iovec *iov, void *data, size_t stride, size_t rows) {
+    for (size_t y = 0; y < rows; ++y) {
+        iov[y].iov_base = (uint8_t*)data + (rows - y - 1)*stride;
+        iov[y].iov_len = stride;
+    }
+}
+
+// Writes all of the iovecs, retrying on EINTR and resuming after short writes.
+// The table itself is never modified so prebuilt tables can be reused.
+static bool write_iov_all(int fd, const struct iovec *iov, size_t count) {
+    size_t i = 0;
+    size_t offset = 0; // Bytes of iov[i] that are already written
+    for (;;) {
+        // Skip everything that is already written, including the empty iovecs
+        while (i < count && offset >= iov[i].iov_len) {
+            offset -= iov[i].iov_len;
+            i += 1;
+        }
+        if (i >= count) return true;
+
+        ssize_t n;
+        if (offset > 0) {
+            n = write(fd, (uint8_t*)iov[i].iov_base + offset, iov[i].iov_len - offset);
+        } else {
+            n = writev(fd, &iov[i], count - i < IOV_MAX ? count - i : IOV_MAX);
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) {
+            errno = EIO;
+            return false;
+        }
+        offset += n;
+    }
+}
+
+// Runs in the child right before exec, so ffmpeg's stderr ends up in the log file
+static void redirect_stderr(const char *log_path) {
+    if (log_path == NULL) return;
+    int fd = open(log_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        TraceLog(LOG_WARNING, "FFMPEG CHILD: Could not open log file %s: %s", log_path, strerror(errno));
+        return;
+    }
+    if (dup2(fd, STDERR_FILENO) < 0) {
+        TraceLog(LOG_WARNING, "FFMPEG CHILD: Could not redirect stderr into %s: %s", log_path, strerror(errno));
+    }
+    close(fd);
+}
+
+static void enlarge_pipe(int fd) {
+    if (fcntl(fd, F_SETPIPE_SZ, FFMPEG_PIPE_SIZE) < 0) {
+        TraceLog(LOG_WARNING, "FFMPEG: could not enlarge the pipe to %d bytes: %s", FFMPEG_PIPE_SIZE, strerror(errno));
+    }
+}
+
+static void sem_wait_uninterrupted(sem_t *sem) {
+    while (sem_wait(sem) < 0 && errno == EINTR);
+}
+
+static void slot_alloc(FFMPEG_Slot *slot, size_t stride, size_t rows) {
+    memset(slot, 0, sizeof(*slot));
+    slot->data = malloc(stride*rows);
+    assert(slot->data != NULL && "Buy MORE RAM lol!!");
+    slot->iov = malloc(sizeof(struct iovec)*rows);
+    assert(slot->iov != NULL && "Buy MORE RAM lol!!");
+    slot->iov_count = rows;
+    iov_flipped(slot->iov, slot->data, stride, rows);
+}
+
+static void slot_free(FFMPEG_Slot *slot) {
+    free(slot->data);
+    free(slot->iov);
+}
+
+static void queue_init(FFMPEG_Queue *q, size_t capacity, size_t stride, size_t rows) {
+    assert(capacity <= FFMPEG_QUEUE_CAPACITY);
+    memset(q, 0, sizeof(*q));
+    q->capacity = capacity;
+    for (size_t i = 0; i < capacity; ++i) {
+        slot_alloc(&q->slots[i], stride, rows);
+    }
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    sem_init(&q->items, 0, 0);
+    sem_init(&q->space, 0, capacity);
+}
+
+static void queue_free(FFMPEG_Queue *q) {
+    for (size_t i = 0; i < q->capacity; ++i) {
+        slot_free(&q->slots[i]);
+    }
+    sem_destroy(&q->items);
+    sem_destroy(&q->space);
+}
+
+// Producer side: wait for a free slot, fill it in, then publish it with queue_push()
+static FFMPEG_Slot *queue_back(FFMPEG_Queue *q) {
+    sem_wait_uninterrupted(&q->space);
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    return &q->slots[head%q->capacity];
+}
+
+static void queue_push(FFMPEG_Queue *q) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    sem_post(&q->items);
+}
+
+// Consumer side: wait for a published slot, consume it, then recycle it with queue_pop()
+static FFMPEG_Slot *queue_front(FFMPEG_Queue *q) {
+    sem_wait_uninterrupted(&q->items);
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    assert(tail < atomic_load_explicit(&q->head, memory_order_acquire));
+    return &q->slots[tail%q->capacity];
+}
+
+static void queue_pop(FFMPEG_Queue *q) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    sem_post(&q->space);
+}
+
+static void *ffmpeg_writer(void *arg) {
+    FFMPEG *ffmpeg = arg;
+    trace_thread_name("ffmpeg writer");
+    for (;;) {
+        FFMPEG_Slot *slot = queue_front(&ffmpeg->queue);
+        if (slot->size == 0) {
+            queue_pop(&ffmpeg->queue);
+            break;
+        }
+        FFMPEG_Slot *frame = slot->repeat ? &ffmpeg->last : slot;
+        // After a failure keep draining the queue so the render thread never blocks on a dead ffmpeg
+        if (!atomic_load(&ffmpeg->failed) && frame->size > 0) {
+            trace_begin(slot->repeat ? "pipe write (repeat)" : "pipe write");
+            if (!write_iov_all(ffmpeg->pipe, frame->iov, frame->iov_count)) {
+                TraceLog(LOG_ERROR, "FFMPEG: failed to write frame into ffmpeg pipe: %s", strerror(errno));
+                atomic_store(&ffmpeg->failed, true);
+            }
+            trace_end();
+        }
+        if (!slot->repeat) {
+            FFMPEG_Slot last = ffmpeg->last;
+            ffmpeg->last = *slot;
+            *slot = last;
+        }
+        queue_pop(&ffmpeg->queue);
+    }
+    return NULL;
+}
+
 FFMPEG *ffmpeg_start_rendering_video(const char *output_path, size_t width, size_t height, size_t fps) {
-    int pipefd[2];
+    return ffmpeg_start_rendering_video_ex(output_path, (FFMPEG_Video_Params) {
+        .width = width,
+        .height = height,
+        .fps = fps,
+        .pixel_format = FFMPEG_PIXEL_FORMAT_RGBA,
+    });
+}
 
+FFMPEG *ffmpeg_start_rendering_video_ex(const char *output_path, FFMPEG_Video_Params params) {
+#ifdef PANIM_LIBAV
+    FFMPEG_Libav *libav = ffmpeg_libav_start(output_path, params);
+    if (libav != NULL) {
+        FFMPEG *ffmpeg = malloc(sizeof(FFMPEG));
+        assert(ffmpeg != NULL && "Buy MORE RAM lol!!");
+        memset(ffmpeg, 0, sizeof(*ffmpeg));
+        ffmpeg->pipe = -1;
+        ffmpeg->sound_pipe = -1;
+        ffmpeg->pixel_format = params.pixel_format;
+        ffmpeg->libav = libav;
+        return ffmpeg;
+    }
+    TraceLog(LOG_WARNING, "FFMPEG: could not encode with libav, falling back to the ffmpeg binary");
+#endif // PANIM_LIBAV
+
+    size_t width = params.width;
+    size_t height = params.height;
+    size_t fps = params.fps;
+
+    // The frame is sent as `rows` rows of `stride` bytes
+    const char *pixel_format = NULL;
+    size_t stride = 0;
+    size_t rows = 0;
+    switch (params.pixel_format) {
+        case FFMPEG_PIXEL_FORMAT_RGBA: {
+            pixel_format = "rgba";
+            stride = width*sizeof(uint32_t);
+            rows = height;
+        } break;
+        case FFMPEG_PIXEL_FORMAT_YUV420P: {
+            // The planes are already in the right order, so the frame is a single "row"
+            assert(width%2 == 0 && height%2 == 0);
+            pixel_format = "yuv420p";
+            stride = width*height*3/2;
+            rows = 1;
+        } break;
+        default: assert(0 && "Unreachable");
+    }
+
+    bool with_sound = params.sound_sample_rate > 0 && params.sound_channels > 0;
+
+    int pipefd[2];
     if (pipe(pipefd) < 0) {
         TraceLog(LOG_ERROR, "FFMPEG: Could not create a pipe: %s", strerror(errno));
         return NULL;
     }
 
+    int sound_pipefd[2] = {-1, -1};
+    if (with_sound && pipe(sound_pipefd) < 0) {
+        TraceLog(LOG_ERROR, "FFMPEG: Could not create a pipe for the sound: %s", strerror(errno));
+        close(pipefd[READ_END]);
+        close(pipefd[WRITE_END]);
+        return NULL;
+    }
+
     pid_t child = fork();
     if (child < 0) {
         TraceLog(LOG_ERROR, "FFMPEG: Could not fork a child: %s", strerror(errno));
@@ -42,31 +338,64 @@ FFMPEG *ffmpeg_start_rendering_video(const char *output_path, size_t width, size
         }
         close(pipefd[WRITE_END]); // Close the write end in the child process
 
+        if (with_sound) {
+            if (dup2(sound_pipefd[READ_END], SOUND_FILENO) < 0) {
+                TraceLog(LOG_ERROR, "FFMPEG CHILD: Could not reopen read end of the sound pipe as fd %d: %s", SOUND_FILENO, strerror(errno));
+                exit(1);
+            }
+            close(sound_pipefd[WRITE_END]);
+        }
+        redirect_stderr(params.log_path);
+
         char resolution[64];
         snprintf(resolution, sizeof(resolution), "%zux%zu", width, height);
         char framerate[64];
         snprintf(framerate, sizeof(framerate), "%zu", fps);
-
-        int ret = execlp("ffmpeg",
+        char sample_rate[64];
+        snprintf(sample_rate, sizeof(sample_rate), "%zu", params.sound_sample_rate);
+        char channels[64];
+        snprintf(channels, sizeof(channels), "%zu", params.sound_channels);
+        char sound_input[64];
+        snprintf(sound_input, sizeof(sound_input), "pipe:%d", SOUND_FILENO);
+
+        Nob_Cmd cmd = {0};
+        nob_cmd_append(&cmd,
             "ffmpeg",
             "-loglevel", "verbose",
             "-y",
 
             "-f", "rawvideo",
-            "-pix_fmt", "rgba",
+            "-pix_fmt", pixel_format,
             "-s", resolution,
             "-r", framerate,
-            "-i", "-",
-
-            "-c:v", "libx264",
-            "-vb", "2500k",
+            "-i", "-");
+        if (with_sound) {
+            // ffmpeg demuxes both inputs on their own threads, the queue just has to
+            // be deep enough that the sound never waits behind the slower video
+            nob_cmd_append(&cmd,
+                "-thread_queue_size", "1024",
+                "-f", "s16le",
+                "-sample_rate", sample_rate,
+                "-channels", channels,
+                "-i", sound_input);
+        }
+        char crf[64];
+        snprintf(crf, sizeof(crf), "%zu", params.crf);
+        nob_cmd_append(&cmd, "-c:v", params.codec ? params.codec : "libx264");
+        if (params.preset) nob_cmd_append(&cmd, "-preset", params.preset);
+        if (params.crf > 0) {
+            nob_cmd_append(&cmd, "-crf", crf);
+        } else {
+            nob_cmd_append(&cmd, "-b:v", params.bitrate ? params.bitrate : "2500k");
+        }
+        nob_cmd_append(&cmd,
             "-c:a", "aac",
             "-ab", "200k",
             "-pix_fmt", "yuv420p",
-            output_path,
+            output_path);
+        nob_da_append(&cmd, NULL);
 
-            NULL
-        );
+        int ret = execvp(cmd.items[0], (char * const*)cmd.items);
         if (ret < 0) {
             TraceLog(LOG_ERROR, "FFMPEG CHILD: Could not run ffmpeg as a child process: %s", strerror(errno));
             exit(1);
@@ -77,16 +406,52 @@ FFMPEG *ffmpeg_start_rendering_video(const char *output_path, size_t width, size
     if (close(pipefd[READ_END]) < 0) {
         TraceLog(LOG_WARNING, "FFMPEG: could not close read end of the pipe on the parent's end: %s", strerror(errno));
     }
+    if (with_sound && close(sound_pipefd[READ_END]) < 0) {
+        TraceLog(LOG_WARNING, "FFMPEG: could not close read end of the sound pipe on the parent's end: %s", strerror(errno));
+    }
+
+    enlarge_pipe(pipefd[WRITE_END]);
+    if (with_sound) enlarge_pipe(sound_pipefd[WRITE_END]);
+    // The writer thread must see EPIPE instead of killing the whole process when ffmpeg dies
+    signal(SIGPIPE, SIG_IGN);
 
     FFMPEG *ffmpeg = malloc(sizeof(FFMPEG));
     assert(ffmpeg != NULL && "Buy MORE RAM lol!!");
+    memset(ffmpeg, 0, sizeof(*ffmpeg));
     ffmpeg->pid = child;
     ffmpeg->pipe = pipefd[WRITE_END];
+    ffmpeg->sound_pipe = sound_pipefd[WRITE_END];
+    if (params.log_path) ffmpeg->log_path = strdup(params.log_path);
+    ffmpeg->pixel_format = params.pixel_format;
+    ffmpeg->threaded = true;
+    ffmpeg->frame_size = stride*rows;
+    atomic_init(&ffmpeg->failed, false);
+    slot_alloc(&ffmpeg->last, stride, rows);
+    queue_init(&ffmpeg->queue, FFMPEG_QUEUE_CAPACITY, stride, rows);
+
+    int ret = pthread_create(&ffmpeg->writer, NULL, ffmpeg_writer, ffmpeg);
+    if (ret != 0) {
+        TraceLog(LOG_WARNING, "FFMPEG: could not start the writer thread, writing frames synchronously: %s", strerror(ret));
+        queue_free(&ffmpeg->queue);
+        ffmpeg->threaded = false;
+    }
 
     return ffmpeg;
 }
 
-FFMPEG *ffmpeg_start_rendering_audio(const char *output_path) {
+FFMPEG *ffmpeg_start_rendering_audio(const char *output_path, const char *log_path) {
+    if (nob_sv_end_with(nob_sv_from_cstr(output_path), ".wav")) {
+        Wav_Writer *wav = wav_writer_open(output_path, 44100, 2);
+        if (wav == NULL) return NULL;
+        FFMPEG *ffmpeg = malloc(sizeof(FFMPEG));
+        assert(ffmpeg != NULL && "Buy MORE RAM lol!!");
+        memset(ffmpeg, 0, sizeof(*ffmpeg));
+        ffmpeg->pipe = -1;
+        ffmpeg->sound_pipe = -1;
+        ffmpeg->wav = wav;
+        return ffmpeg;
+    }
+
     int pipefd[2];
 
     if (pipe(pipefd) < 0) {
@@ -107,6 +472,7 @@ FFMPEG *ffmpeg_start_rendering_audio(const char *output_path) {
 
         }
         close(pipefd[WRITE_END]);
+        redirect_stderr(log_path);
 
         int ret = execlp("ffmpeg",
             "ffmpeg",
@@ -136,24 +502,264 @@ FFMPEG *ffmpeg_start_rendering_audio(const char *output_path) {
         TraceLog(LOG_WARNING, "FFMPEG: Could not close read end of the pipe on the parent's end: %s", strerror(errno));
     }
 
+    enlarge_pipe(pipefd[WRITE_END]);
+    signal(SIGPIPE, SIG_IGN);
+
     FFMPEG *ffmpeg = malloc(sizeof(FFMPEG));
     assert(ffmpeg != NULL && "Buy MORE RAM lol!!");
+    memset(ffmpeg, 0, sizeof(*ffmpeg));
     ffmpeg->pid = child;
     ffmpeg->pipe = pipefd[WRITE_END];
+    ffmpeg->sound_pipe = pipefd[WRITE_END];
+    if (log_path) ffmpeg->log_path = strdup(log_path);
     return ffmpeg;
 }
 
+static void image_path(FFMPEG *ffmpeg, size_t frame, char *path, size_t path_size) {
+    snprintf(path, path_size, ffmpeg->image_pattern, (int)frame);
+}
+
+static bool write_image(FFMPEG_Image_Worker *worker, FFMPEG_Slot *slot) {
+    FFMPEG *ffmpeg = worker->ffmpeg;
+    size_t width = ffmpeg->image_params.width;
+    size_t height = ffmpeg->image_params.height;
+    size_t stride = width*sizeof(uint32_t);
+
+    char path[PATH_MAX];
+    image_path(ffmpeg, slot->frame, path, sizeof(path));
+
+    // The frame did not change, so its file is the same file as the previous one
+    if (slot->repeat) {
+        char last_path[PATH_MAX];
+        image_path(ffmpeg, worker->last_frame, last_path, sizeof(last_path));
+        if (unlink(path) < 0 && errno != ENOENT) {
+            TraceLog(LOG_ERROR, "FFMPEG: could not remove %s: %s", path, strerror(errno));
+            return false;
+        }
+        if (link(last_path, path) < 0) {
+            TraceLog(LOG_ERROR, "FFMPEG: could not link %s to %s: %s", path, last_path, strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        TraceLog(LOG_ERROR, "FFMPEG: could not open %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    bool ok = false;
+    switch (ffmpeg->image_params.format) {
+        case FFMPEG_IMAGE_FORMAT_RAW: {
+            ok = write_iov_all(fd, slot->iov, slot->iov_count);
+        } break;
+        case FFMPEG_IMAGE_FORMAT_QOI: {
+            size_t size = 0;
+            uint8_t *last_row = (uint8_t*)slot->data + (height - 1)*stride;
+            uint8_t *bytes = qoi_encode_rgba(last_row, width, height, -(ptrdiff_t)stride, &size);
+            struct iovec iov = { .iov_base = bytes, .iov_len = size };
+            ok = write_iov_all(fd, &iov, 1);
+            free(bytes);
+        } break;
+        case FFMPEG_IMAGE_FORMAT_PNG: {
+            for (size_t y = 0; y < slot->iov_count; ++y) {
+                memcpy(worker->scratch + y*stride, slot->iov[y].iov_base, stride);
+            }
+            Image image = {
+                .data = worker->scratch,
+                .width = width,
+                .height = height,
+                .mipmaps = 1,
+                .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+            };
+            int size = 0;
+            unsigned char *bytes = ExportImageToMemory(image, ".png", &size);
+            if (bytes != NULL) {
+                struct iovec iov = { .iov_base = bytes, .iov_len = size };
+                ok = write_iov_all(fd, &iov, 1);
+                MemFree(bytes);
+            }
+        } break;
+        default: assert(0 && "Unreachable");
+    }
+    if (!ok) TraceLog(LOG_ERROR, "FFMPEG: could not write %s: %s", path, strerror(errno));
+    if (close(fd) < 0) ok = false;
+    return ok;
+}
+
+static void *ffmpeg_image_worker(void *arg) {
+    FFMPEG_Image_Worker *worker = arg;
+    FFMPEG *ffmpeg = worker->ffmpeg;
+    trace_thread_name("image worker");
+    for (;;) {
+        FFMPEG_Slot *slot = queue_front(&worker->queue);
+        if (slot->size == 0) {
+            queue_pop(&worker->queue);
+            break;
+        }
+        trace_begin("write image");
+        if (!atomic_load(&ffmpeg->failed) && !write_image(worker, slot)) {
+            atomic_store(&ffmpeg->failed, true);
+        }
+        trace_end();
+        if (!slot->repeat) worker->last_frame = slot->frame;
+        queue_pop(&worker->queue);
+    }
+    return NULL;
+}
+
+// The pattern must have exactly one %d conversion for the frame number
+static bool image_pattern_valid(const char *pattern) {
+    size_t conversions = 0;
+    for (const char *p = pattern; *p != '\0'; ++p) {
+        if (*p != '%') continue;
+        p += 1;
+        if (*p == '%') continue;
+        while (*p == '0' || *p == '-' || *p == ' ' || *p == '+') p += 1;
+        while (*p >= '0' && *p <= '9') p += 1;
+        if (*p != 'd') return false;
+        conversions += 1;
+    }
+    return conversions == 1;
+}
+
+FFMPEG *ffmpeg_start_rendering_images(const char *path_pattern, FFMPEG_Image_Params params) {
+    if (!image_pattern_valid(path_pattern)) {
+        TraceLog(LOG_ERROR, "FFMPEG: %s must have exactly one %%d for the frame number, e.g. frames/%%05d.qoi", path_pattern);
+        return NULL;
+    }
+    if (params.threads == 0) params.threads = 1;
+
+    size_t stride = params.width*sizeof(uint32_t);
+    size_t rows = params.height;
+
+    FFMPEG *ffmpeg = malloc(sizeof(FFMPEG));
+    assert(ffmpeg != NULL && "Buy MORE RAM lol!!");
+    memset(ffmpeg, 0, sizeof(*ffmpeg));
+    ffmpeg->pipe = -1;
+    ffmpeg->sound_pipe = -1;
+    ffmpeg->pixel_format = FFMPEG_PIXEL_FORMAT_RGBA;
+    ffmpeg->frame_size = stride*rows;
+    atomic_init(&ffmpeg->failed, false);
+    ffmpeg->image_pattern = strdup(path_pattern);
+    ffmpeg->image_params = params;
+    ffmpeg->image_workers = malloc(sizeof(FFMPEG_Image_Worker)*params.threads);
+    assert(ffmpeg->image_workers != NULL && "Buy MORE RAM lol!!");
+
+    for (size_t i = 0; i < params.threads; ++i) {
+        FFMPEG_Image_Worker *worker = &ffmpeg->image_workers[i];
+        memset(worker, 0, sizeof(*worker));
+        worker->ffmpeg = ffmpeg;
+        queue_init(&worker->queue, FFMPEG_IMAGE_QUEUE_CAPACITY, stride, rows);
+        if (params.format == FFMPEG_IMAGE_FORMAT_PNG) {
+            worker->scratch = malloc(stride*rows);
+            assert(worker->scratch != NULL && "Buy MORE RAM lol!!");
+        }
+
+        int ret = pthread_create(&worker->thread, NULL, ffmpeg_image_worker, worker);
+        if (ret != 0) {
+            TraceLog(LOG_WARNING, "FFMPEG: could not start image worker %zu: %s", i, strerror(ret));
+            queue_free(&worker->queue);
+            free(worker->scratch);
+            ffmpeg->image_params.threads = i;
+            break;
+        }
+    }
+    if (ffmpeg->image_params.threads == 0) {
+        free(ffmpeg->image_workers);
+        free(ffmpeg->image_pattern);
+        free(ffmpeg);
+        return NULL;
+    }
+    return ffmpeg;
+}
+
+static bool end_rendering_images(FFMPEG *ffmpeg, bool cancel) {
+    // The workers skip writing after a failure, so a cancel is just a failure on purpose
+    if (cancel) atomic_store(&ffmpeg->failed, true);
+
+    for (size_t i = 0; i < ffmpeg->image_params.threads; ++i) {
+        FFMPEG_Image_Worker *worker = &ffmpeg->image_workers[i];
+        FFMPEG_Slot *slot = queue_back(&worker->queue);
+        slot->size = 0;
+        slot->repeat = false;
+        queue_push(&worker->queue);
+        pthread_join(worker->thread, NULL);
+        queue_free(&worker->queue);
+        free(worker->scratch);
+    }
+
+    bool failed = atomic_load(&ffmpeg->failed);
+    free(ffmpeg->image_workers);
+    free(ffmpeg->image_pattern);
+    free(ffmpeg);
+    return !failed;
+}
+
+static bool send_image(FFMPEG *ffmpeg, void *data, bool repeat) {
+    if (atomic_load(&ffmpeg->failed)) return false;
+
+    // A repeat is linked to the file of the previous frame, so it goes to the worker that writes that file
+    if (!repeat) ffmpeg->image_worker = (ffmpeg->image_worker + 1)%ffmpeg->image_params.threads;
+    FFMPEG_Image_Worker *worker = &ffmpeg->image_workers[ffmpeg->image_worker];
+
+    FFMPEG_Slot *slot = queue_back(&worker->queue);
+    if (!repeat) memcpy(slot->data, data, ffmpeg->frame_size);
+    slot->size = ffmpeg->frame_size;
+    slot->repeat = repeat;
+    slot->frame = ffmpeg->image_params.first_frame + ffmpeg->image_frames;
+    ffmpeg->image_frames += 1;
+    queue_push(&worker->queue);
+    return true;
+}
+
 bool ffmpeg_end_rendering(FFMPEG *ffmpeg, bool cancel) {
+    if (ffmpeg->image_workers) return end_rendering_images(ffmpeg, cancel);
+    if (ffmpeg->wav) {
+        bool ok = wav_writer_close(ffmpeg->wav, cancel);
+        free(ffmpeg);
+        return ok;
+    }
+#ifdef PANIM_LIBAV
+    if (ffmpeg->libav) {
+        bool ok = ffmpeg_libav_end(ffmpeg->libav, cancel);
+        free(ffmpeg);
+        return ok;
+    }
+#endif // PANIM_LIBAV
+
     int pipe = ffmpeg->pipe;
     pid_t pid = ffmpeg->pid;
 
+    // Killing ffmpeg first makes the writer thread fail fast instead of flushing the queue
+    if (cancel) kill(pid, SIGKILL);
+
+    bool failed = false;
+    if (ffmpeg->threaded) {
+        FFMPEG_Slot *slot = queue_back(&ffmpeg->queue);
+        slot->size = 0;
+        slot->repeat = false;
+        queue_push(&ffmpeg->queue);
+        pthread_join(ffmpeg->writer, NULL);
+        queue_free(&ffmpeg->queue);
+        failed = atomic_load(&ffmpeg->failed);
+    }
+
+    int sound_pipe = ffmpeg->sound_pipe;
+    // Only used to point at the details when ffmpeg fails
+    char log_hint[1024] = "";
+    if (ffmpeg->log_path) snprintf(log_hint, sizeof(log_hint), ", see %s for details", ffmpeg->log_path);
+    free(ffmpeg->log_path);
+    slot_free(&ffmpeg->last);
     free(ffmpeg);
-    
+
     if (close(pipe) < 0) {
         TraceLog(LOG_WARNING, "FFMPEG: could not close write end of the pipe on the parent's end: %s", strerror(errno));
     }
-
-    if (cancel) kill(pid, SIGKILL);
+    if (sound_pipe >= 0 && sound_pipe != pipe && close(sound_pipe) < 0) {
+        TraceLog(LOG_WARNING, "FFMPEG: could not close write end of the sound pipe on the parent's end: %s", strerror(errno));
+    }
 
     for (;;) {
         int wstatus = 0;
@@ -165,31 +771,78 @@ bool ffmpeg_end_rendering(FFMPEG *ffmpeg, bool cancel) {
         if (WIFEXITED(wstatus)) {
             int exit_status = WEXITSTATUS(wstatus);
             if (exit_status != 0) {
-                TraceLog(LOG_ERROR, "FFMPEG: ffmpeg exited with code %d", exit_status);
+                TraceLog(LOG_ERROR, "FFMPEG: ffmpeg exited with code %d%s", exit_status, log_hint);
                 return false;
             }
-            return true;
+            return !failed;
         }
         if (WIFSIGNALED(wstatus)) {
-            TraceLog(LOG_ERROR, "FFMPEG: ffmpeg got terminated by %s", strsignal(WTERMSIG(wstatus)));
+            TraceLog(LOG_ERROR, "FFMPEG: ffmpeg got terminated by %s%s", strsignal(WTERMSIG(wstatus)), log_hint);
             return false;
         }
     }
     assert(0 && "Unreachable");
 }
 
-bool ffmpeg_send_frame_flipped(FFMPEG *ffmpeg, void *data, size_t width, size_t height) {
-    for (size_t y = height; y > 0; --y) {
-        if (write(ffmpeg->pipe, (uint32_t*)data + (y - 1) * width, sizeof(uint32_t) * width) < 0) {
-            TraceLog(LOG_ERROR, "FFMPEG: failed to write frame into ffmpeg pipe: %s", strerror(errno));
-            return false;
-        }
+static bool send_frame(FFMPEG *ffmpeg, void *data, bool repeat) {
+    if (ffmpeg->image_workers) return send_image(ffmpeg, data, repeat);
+#ifdef PANIM_LIBAV
+    if (ffmpeg->libav) return repeat ? ffmpeg_libav_repeat_frame(ffmpeg->libav) : ffmpeg_libav_send_frame(ffmpeg->libav, data);
+#endif // PANIM_LIBAV
+
+    if (ffmpeg->threaded) {
+        if (atomic_load(&ffmpeg->failed)) return false;
+
+        // The slot's iovec table already points at its rows in the order ffmpeg expects
+        FFMPEG_Slot *slot = queue_back(&ffmpeg->queue);
+        if (!repeat) memcpy(slot->data, data, ffmpeg->frame_size);
+        slot->size = ffmpeg->frame_size;
+        slot->repeat = repeat;
+        queue_push(&ffmpeg->queue);
+        return true;
+    }
+
+    if (!repeat) {
+        memcpy(ffmpeg->last.data, data, ffmpeg->frame_size);
+        ffmpeg->last.size = ffmpeg->frame_size;
+    }
+    if (ffmpeg->last.size == 0) return true;
+    trace_begin("pipe write");
+    bool ok = write_iov_all(ffmpeg->pipe, ffmpeg->last.iov, ffmpeg->last.iov_count);
+    trace_end();
+    if (!ok) {
+        TraceLog(LOG_ERROR, "FFMPEG: failed to write frame into ffmpeg pipe: %s", strerror(errno));
+        return false;
     }
     return true;
 }
 
+bool ffmpeg_send_frame_flipped(FFMPEG *ffmpeg, void *data, size_t width, size_t height) {
+    assert(ffmpeg->pixel_format == FFMPEG_PIXEL_FORMAT_RGBA);
+    assert(width*height*sizeof(uint32_t) == ffmpeg->frame_size);
+    return send_frame(ffmpeg, data, false);
+}
+
+bool ffmpeg_send_frame(FFMPEG *ffmpeg, void *data) {
+    assert(ffmpeg->pixel_format == FFMPEG_PIXEL_FORMAT_YUV420P);
+    return send_frame(ffmpeg, data, false);
+}
+
+bool ffmpeg_repeat_frame(FFMPEG *ffmpeg) {
+    return send_frame(ffmpeg, NULL, true);
+}
+
 bool ffmpeg_send_sound_samples(FFMPEG *ffmpeg, void *data, size_t size) {
-    if (write(ffmpeg->pipe, data, size) < 0) {
+#ifdef PANIM_LIBAV
+    if (ffmpeg->libav) return ffmpeg_libav_send_sound_samples(ffmpeg->libav, data, size);
+#endif // PANIM_LIBAV
+    if (ffmpeg->wav) return wav_writer_write(ffmpeg->wav, data, size);
+    struct iovec iov = { .iov_base = data, .iov_len = size };
+    assert(ffmpeg->sound_pipe >= 0 && "The rendering was started without sound");
+    trace_begin("sound pipe write");
+    bool ok = write_iov_all(ffmpeg->sound_pipe, &iov, 1);
+    trace_end();
+    if (!ok) {
         TraceLog(LOG_ERROR, "FFMPEG: failed to write sound into ffmpeg pipe: %s", strerror(errno));
         return false;
     }
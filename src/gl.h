@@ -0,0 +1,70 @@
+#ifndef GL_H_
+#define GL_H_
+
+// OpenGL entry points that rlgl does not wrap. Raylib already loads the whole
+// GL 3.3 API through glad and exports the function pointers from libraylib.so,
+// so we just borrow them instead of bringing our own loader.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GL_RGBA                        0x1908
+#define GL_UNSIGNED_BYTE               0x1401
+#define GL_FRAMEBUFFER                 0x8D40
+#define GL_READ_FRAMEBUFFER            0x8CA8
+#define GL_PIXEL_PACK_BUFFER           0x88EB
+#define GL_STREAM_READ                 0x88E1
+#define GL_MAP_READ_BIT                0x0001
+#define GL_SYNC_GPU_COMMANDS_COMPLETE  0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT     0x00000001
+#define GL_ALREADY_SIGNALED            0x911A
+#define GL_TIMEOUT_EXPIRED             0x911B
+#define GL_CONDITION_SATISFIED         0x911C
+#define GL_WAIT_FAILED                 0x911D
+#define GL_TIMEOUT_IGNORED             0xFFFFFFFFFFFFFFFFull
+#define GL_TIME_ELAPSED                0x88BF
+#define GL_QUERY_RESULT                0x8866
+#define GL_QUERY_RESULT_AVAILABLE      0x8867
+
+typedef struct __GLsync *GLsync;
+
+extern void (*glad_glGenBuffers)(int n, unsigned int *buffers);
+extern void (*glad_glDeleteBuffers)(int n, const unsigned int *buffers);
+extern void (*glad_glBindBuffer)(unsigned int target, unsigned int buffer);
+extern void (*glad_glBufferData)(unsigned int target, ptrdiff_t size, const void *data, unsigned int usage);
+extern void *(*glad_glMapBufferRange)(unsigned int target, ptrdiff_t offset, ptrdiff_t length, unsigned int access);
+extern unsigned char (*glad_glUnmapBuffer)(unsigned int target);
+extern void (*glad_glBindFramebuffer)(unsigned int target, unsigned int framebuffer);
+extern void (*glad_glReadPixels)(int x, int y, int width, int height, unsigned int format, unsigned int type, void *pixels);
+extern GLsync (*glad_glFenceSync)(unsigned int condition, unsigned int flags);
+extern unsigned int (*glad_glClientWaitSync)(GLsync sync, unsigned int flags, uint64_t timeout);
+extern void (*glad_glDeleteSync)(GLsync sync);
+extern void (*glad_glGenQueries)(int n, unsigned int *ids);
+extern void (*glad_glDeleteQueries)(int n, const unsigned int *ids);
+extern void (*glad_glBeginQuery)(unsigned int target, unsigned int id);
+extern void (*glad_glEndQuery)(unsigned int target);
+extern void (*glad_glGetQueryObjectiv)(unsigned int id, unsigned int pname, int *params);
+extern void (*glad_glGetQueryObjectui64v)(unsigned int id, unsigned int pname, uint64_t *params);
+// rlgl submits everything through these, so replacing the pointers counts its draw calls
+extern void (*glad_glDrawArrays)(unsigned int mode, int first, int count);
+extern void (*glad_glDrawElements)(unsigned int mode, int count, unsigned int type, const void *indices);
+
+#define glGenBuffers glad_glGenBuffers
+#define glDeleteBuffers glad_glDeleteBuffers
+#define glBindBuffer glad_glBindBuffer
+#define glBufferData glad_glBufferData
+#define glMapBufferRange glad_glMapBufferRange
+#define glUnmapBuffer glad_glUnmapBuffer
+#define glBindFramebuffer glad_glBindFramebuffer
+#define glReadPixels glad_glReadPixels
+#define glFenceSync glad_glFenceSync
+#define glClientWaitSync glad_glClientWaitSync
+#define glDeleteSync glad_glDeleteSync
+#define glGenQueries glad_glGenQueries
+#define glDeleteQueries glad_glDeleteQueries
+#define glBeginQuery glad_glBeginQuery
+#define glEndQuery glad_glEndQuery
+#define glGetQueryObjectiv glad_glGetQueryObjectiv
+#define glGetQueryObjectui64v glad_glGetQueryObjectui64v
+
+#endif // GL_H_
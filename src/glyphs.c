@@ -0,0 +1,358 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <raylib.h>
+#include <rlgl.h>
+
+#include "nob.h"
+#include "glyphs.h"
+
+#define GLYPHS_PAGE_SIZE 1024
+#define GLYPHS_PAGE_BYTES (GLYPHS_PAGE_SIZE*GLYPHS_PAGE_SIZE*2)
+// The glyphs that reach out of the em square, like the accented capitals, still fit in the cell.
+// The distance fields of raylib add 4 pixels around every glyph.
+#define GLYPHS_CELL_SCALE 1.5f
+#define GLYPHS_SDF_PADDING 4
+// The same default as raylib's SetTextLineSpacing()
+#define GLYPHS_LINE_SPACING 2
+
+typedef struct {
+    int codepoint;
+    int offset_x;
+    int offset_y;
+    int advance_x;
+    int width;  // Of the image in the cell, 0 for the glyphs that draw nothing like the space
+    int height;
+    int page;   // -1 when the glyph is not in the atlas
+    int cell;
+    uint64_t last_used;
+    unsigned char *image; // Of a glyph that was measured but not drawn yet, it goes into a cell when it's drawn
+} Glyph;
+
+typedef struct {
+    Texture2D texture;
+    unsigned char *pixels; // GRAY_ALPHA, the rows that changed are uploaded in one go
+    int dirty_begin;       // The changed rows [begin, end)
+    int dirty_end;
+    int *cells;            // The glyph in every cell or -1
+} Glyph_Page;
+
+typedef struct {
+    int page;
+    int cell;
+} Glyph_Cell;
+
+struct Glyph_Font {
+    unsigned char *file_data;
+    int file_size;
+    int font_size;
+    int cell_size;
+    int cells_per_row;
+
+    // Stays even when the glyph leaves the atlas, so the metrics are there without rasterizing it again
+    struct {
+        Glyph *items;
+        size_t count;
+        size_t capacity;
+    } glyphs;
+    // Open addressing from the codepoint to the index of the glyph + 1, 0 for the empty slots
+    int *slots;
+    size_t slots_capacity;
+
+    struct {
+        Glyph_Page *items;
+        size_t count;
+        size_t capacity;
+    } pages;
+    struct {
+        Glyph_Cell *items;
+        size_t count;
+        size_t capacity;
+    } free_cells;
+
+    // Every draw gets a new stamp. The glyphs of the current one are never evicted.
+    uint64_t stamp;
+};
+
+static size_t slot_of(int codepoint, size_t capacity) {
+    return ((uint32_t)codepoint*2654435761u)&(capacity - 1);
+}
+
+static void slots_grow(Glyph_Font *font) {
+    free(font->slots);
+    font->slots_capacity = font->slots_capacity ? font->slots_capacity*2 : 256;
+    font->slots = calloc(font->slots_capacity, sizeof(*font->slots));
+    for (size_t i = 0; i < font->glyphs.count; ++i) {
+        size_t slot = slot_of(font->glyphs.items[i].codepoint, font->slots_capacity);
+        while (font->slots[slot]) slot = (slot + 1)&(font->slots_capacity - 1);
+        font->slots[slot] = i + 1;
+    }
+}
+
+static Glyph *find_glyph(Glyph_Font *font, int codepoint) {
+    if (font->slots_capacity == 0) return NULL;
+    size_t slot = slot_of(codepoint, font->slots_capacity);
+    while (font->slots[slot]) {
+        Glyph *glyph = &font->glyphs.items[font->slots[slot] - 1];
+        if (glyph->codepoint == codepoint) return glyph;
+        slot = (slot + 1)&(font->slots_capacity - 1);
+    }
+    return NULL;
+}
+
+static void add_page(Glyph_Font *font) {
+    Glyph_Page page = {
+        .pixels = calloc(GLYPHS_PAGE_BYTES, 1),
+        .cells = malloc(font->cells_per_row*font->cells_per_row*sizeof(int)),
+    };
+    Image image = {
+        .data = page.pixels,
+        .width = GLYPHS_PAGE_SIZE,
+        .height = GLYPHS_PAGE_SIZE,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA,
+    };
+    page.texture = LoadTextureFromImage(image);
+    SetTextureFilter(page.texture, TEXTURE_FILTER_BILINEAR);
+
+    int page_index = font->pages.count;
+    int cells_count = font->cells_per_row*font->cells_per_row;
+    // Backwards, so the cells are handed out from the top left
+    for (int cell = cells_count - 1; cell >= 0; --cell) {
+        page.cells[cell] = -1;
+        nob_da_append(&font->free_cells, ((Glyph_Cell) {page_index, cell}));
+    }
+    nob_da_append(&font->pages, page);
+}
+
+// The least recently used glyph of the font that is not part of the current text
+static bool evict_glyph(Glyph_Font *font) {
+    Glyph *oldest = NULL;
+    for (size_t i = 0; i < font->glyphs.count; ++i) {
+        Glyph *glyph = &font->glyphs.items[i];
+        if (glyph->page < 0 || glyph->last_used == font->stamp) continue;
+        if (oldest == NULL || glyph->last_used < oldest->last_used) oldest = glyph;
+    }
+    if (oldest == NULL) return false;
+
+    // The quads of the glyph may still wait in the batch of rlgl, they must be drawn before the cell changes
+    rlDrawRenderBatchActive();
+    font->pages.items[oldest->page].cells[oldest->cell] = -1;
+    nob_da_append(&font->free_cells, ((Glyph_Cell) {oldest->page, oldest->cell}));
+    oldest->page = -1;
+    return true;
+}
+
+static Glyph_Cell take_cell(Glyph_Font *font) {
+    if (font->free_cells.count == 0) {
+        // Every font gets at least one page, and when the text alone does not fit into the pages it has,
+        // going over the budget is better than drawing it wrong
+        bool over_budget = (font->pages.count + 1)*GLYPHS_PAGE_BYTES > GLYPHS_FONT_MEMORY_BUDGET;
+        if (font->pages.count == 0 || !over_budget || !evict_glyph(font)) {
+            if (font->pages.count > 0 && over_budget) {
+                TraceLog(LOG_WARNING, "GLYPHS: the text needs more than %d MiB of glyphs", GLYPHS_FONT_MEMORY_BUDGET/(1024*1024));
+            }
+            add_page(font);
+        }
+    }
+    return font->free_cells.items[--font->free_cells.count];
+}
+
+// Rasterizes the distance field of the glyph into glyph->image, the metrics come with it.
+// The image is cut to the cell, so it is always cell_size*cell_size.
+static void rasterize_glyph(Glyph_Font *font, Glyph *glyph) {
+    GlyphInfo *info = LoadFontData(font->file_data, font->file_size, font->font_size, &glyph->codepoint, 1, FONT_SDF);
+    if (info == NULL) {
+        glyph->width = glyph->height = 0;
+        return;
+    }
+    glyph->offset_x = info->offsetX;
+    glyph->offset_y = info->offsetY;
+    glyph->advance_x = info->advanceX;
+    glyph->width = info->image.data ? info->image.width : 0;
+    glyph->height = info->image.data ? info->image.height : 0;
+    if (glyph->width > font->cell_size || glyph->height > font->cell_size) {
+        TraceLog(LOG_WARNING, "GLYPHS: glyph %d of %dx%d does not fit into the cell of %d, it's cut",
+                 glyph->codepoint, glyph->width, glyph->height, font->cell_size);
+        if (glyph->width > font->cell_size) glyph->width = font->cell_size;
+        if (glyph->height > font->cell_size) glyph->height = font->cell_size;
+    }
+
+    if (glyph->width > 0 && glyph->height > 0) {
+        glyph->image = calloc(font->cell_size*font->cell_size, 1);
+        const unsigned char *src = info->image.data;
+        for (int y = 0; y < glyph->height; ++y) {
+            memcpy(glyph->image + y*font->cell_size, src + y*info->image.width, glyph->width);
+        }
+    }
+    UnloadFontData(info, 1);
+}
+
+// Puts the image of the glyph into a cell of the atlas
+static void place_glyph(Glyph_Font *font, Glyph *glyph) {
+    Glyph_Cell cell = take_cell(font);
+    Glyph_Page *page = &font->pages.items[cell.page];
+    page->cells[cell.cell] = glyph - font->glyphs.items;
+    glyph->page = cell.page;
+    glyph->cell = cell.cell;
+
+    // The same layout GenImageFontAtlas() gives the distance fields: white, the distance in the alpha
+    int x0 = (cell.cell%font->cells_per_row)*font->cell_size;
+    int y0 = (cell.cell/font->cells_per_row)*font->cell_size;
+    for (int y = 0; y < font->cell_size; ++y) {
+        unsigned char *dst = page->pixels + ((y0 + y)*GLYPHS_PAGE_SIZE + x0)*2;
+        const unsigned char *src = glyph->image + y*font->cell_size;
+        for (int x = 0; x < font->cell_size; ++x) {
+            dst[x*2 + 0] = 255;
+            dst[x*2 + 1] = src[x];
+        }
+    }
+    if (page->dirty_begin == page->dirty_end) {
+        page->dirty_begin = y0;
+        page->dirty_end = y0 + font->cell_size;
+    } else {
+        if (y0 < page->dirty_begin) page->dirty_begin = y0;
+        if (y0 + font->cell_size > page->dirty_end) page->dirty_end = y0 + font->cell_size;
+    }
+    free(glyph->image);
+    glyph->image = NULL;
+}
+
+// Looks the glyph up, rasterizing it the first time for its metrics. Only `resident` puts it into
+// the atlas, so measuring a text never takes a cell or evicts the glyphs that are about to be drawn.
+static Glyph *use_glyph(Glyph_Font *font, int codepoint, bool resident) {
+    Glyph *glyph = find_glyph(font, codepoint);
+    if (glyph == NULL) {
+        if ((font->glyphs.count + 1)*10 > font->slots_capacity*7) slots_grow(font);
+        nob_da_append(&font->glyphs, ((Glyph) {.codepoint = codepoint, .page = -1}));
+        glyph = &font->glyphs.items[font->glyphs.count - 1];
+        size_t slot = slot_of(codepoint, font->slots_capacity);
+        while (font->slots[slot]) slot = (slot + 1)&(font->slots_capacity - 1);
+        font->slots[slot] = font->glyphs.count;
+        rasterize_glyph(font, glyph);
+    }
+    if (!resident) return glyph;
+
+    glyph->last_used = font->stamp;
+    if (glyph->page < 0 && glyph->width > 0 && glyph->height > 0) {
+        // An evicted glyph gave its image up with its cell
+        if (glyph->image == NULL) rasterize_glyph(font, glyph);
+        if (glyph->image != NULL) place_glyph(font, glyph);
+    }
+    return glyph;
+}
+
+static void upload_pages(Glyph_Font *font) {
+    for (size_t i = 0; i < font->pages.count; ++i) {
+        Glyph_Page *page = &font->pages.items[i];
+        if (page->dirty_begin == page->dirty_end) continue;
+        Rectangle rows = {0, page->dirty_begin, GLYPHS_PAGE_SIZE, page->dirty_end - page->dirty_begin};
+        UpdateTextureRec(page->texture, rows, page->pixels + page->dirty_begin*GLYPHS_PAGE_SIZE*2);
+        page->dirty_begin = page->dirty_end = 0;
+    }
+}
+
+Glyph_Font *glyph_font_load(const char *file_path, int font_size) {
+    int file_size = 0;
+    unsigned char *file_data = LoadFileData(file_path, &file_size);
+    if (file_data == NULL) return NULL;
+
+    Glyph_Font *font = calloc(1, sizeof(*font));
+    font->file_data = file_data;
+    font->file_size = file_size;
+    font->font_size = font_size;
+    font->cell_size = font_size*GLYPHS_CELL_SCALE + 2*GLYPHS_SDF_PADDING;
+    if (font->cell_size > GLYPHS_PAGE_SIZE) font->cell_size = GLYPHS_PAGE_SIZE;
+    font->cells_per_row = GLYPHS_PAGE_SIZE/font->cell_size;
+    return font;
+}
+
+void glyph_font_unload(Glyph_Font *font) {
+    if (font == NULL) return;
+    for (size_t i = 0; i < font->pages.count; ++i) {
+        UnloadTexture(font->pages.items[i].texture);
+        free(font->pages.items[i].pixels);
+        free(font->pages.items[i].cells);
+    }
+    nob_da_free(font->pages);
+    nob_da_free(font->free_cells);
+    for (size_t i = 0; i < font->glyphs.count; ++i) free(font->glyphs.items[i].image);
+    nob_da_free(font->glyphs);
+    free(font->slots);
+    UnloadFileData(font->file_data);
+    free(font);
+}
+
+static float advance_of(const Glyph *glyph, float scale, float spacing) {
+    return (glyph->advance_x == 0 ? glyph->width : glyph->advance_x)*scale + spacing;
+}
+
+Vector2 glyph_font_measure(Glyph_Font *font, const char *text, float size, float spacing) {
+    if (font == NULL) return MeasureTextEx(GetFontDefault(), text, size, spacing);
+
+    float scale = size/font->font_size;
+    float line_width = 0.0f;
+    Vector2 text_size = {0.0f, size};
+    for (int i = 0; text[i] != '\0';) {
+        int n = 0;
+        int codepoint = GetCodepointNext(&text[i], &n);
+        i += n;
+        if (codepoint == '\n') {
+            line_width = 0.0f;
+            text_size.y += size + GLYPHS_LINE_SPACING;
+            continue;
+        }
+        // A whole line of advances and spacings, the last spacing is not part of the text
+        line_width += advance_of(use_glyph(font, codepoint, false), scale, spacing);
+        if (line_width - spacing > text_size.x) text_size.x = line_width - spacing;
+    }
+    return text_size;
+}
+
+void glyph_font_draw(Glyph_Font *font, const char *text, Vector2 position, float size, float spacing, Color color) {
+    if (font == NULL) {
+        DrawTextEx(GetFontDefault(), text, position, size, spacing, color);
+        return;
+    }
+
+    // All the glyphs of the text go into the atlas first, so the pages are uploaded once
+    font->stamp += 1;
+    for (int i = 0; text[i] != '\0';) {
+        int n = 0;
+        int codepoint = GetCodepointNext(&text[i], &n);
+        i += n;
+        if (codepoint != '\n') use_glyph(font, codepoint, true);
+    }
+    upload_pages(font);
+
+    float scale = size/font->font_size;
+    Vector2 offset = {0};
+    for (int i = 0; text[i] != '\0';) {
+        int n = 0;
+        int codepoint = GetCodepointNext(&text[i], &n);
+        i += n;
+        if (codepoint == '\n') {
+            offset.x = 0.0f;
+            offset.y += size + GLYPHS_LINE_SPACING;
+            continue;
+        }
+        const Glyph *glyph = find_glyph(font, codepoint);
+        if (glyph->page >= 0) {
+            Rectangle source = {
+                (glyph->cell%font->cells_per_row)*font->cell_size,
+                (glyph->cell/font->cells_per_row)*font->cell_size,
+                glyph->width,
+                glyph->height,
+            };
+            Rectangle dest = {
+                position.x + offset.x + glyph->offset_x*scale,
+                position.y + offset.y + glyph->offset_y*scale,
+                glyph->width*scale,
+                glyph->height*scale,
+            };
+            DrawTexturePro(font->pages.items[glyph->page].texture, source, dest, (Vector2) {0}, 0.0f, color);
+        }
+        offset.x += advance_of(glyph, scale, spacing);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef GLYPHS_H_
+#define GLYPHS_H_
+
+#include <raylib.h>
+
+// Fonts that rasterize the characters the first time they are drawn, so a scene can draw any
+// text without listing its characters up front. The glyphs are signed distance fields in cells
+// of atlas pages. The cells of a page are as big as the glyphs of its font, so every font has its
+// own pages. Once the pages of a font reach GLYPHS_FONT_MEMORY_BUDGET, its glyphs that were not
+// drawn for the longest time give up their cells to its new ones.
+
+// Of the textures of the pages of one font, the copies on the CPU take as much again
+#define GLYPHS_FONT_MEMORY_BUDGET (8*1024*1024)
+
+typedef struct Glyph_Font Glyph_Font;
+
+// Only reads the file, nothing is rasterized yet. Returns NULL when it can't be read.
+Glyph_Font *glyph_font_load(const char *file_path, int font_size);
+void glyph_font_unload(Glyph_Font *font);
+// Work like MeasureTextEx() and DrawTextEx(). A NULL font falls back to the default font of raylib.
+// Measuring only needs the metrics of the glyphs, they go into the atlas when they are drawn.
+// The text has to be drawn with a distance field shader, which Asset_Funcs.draw_glyph_text() does.
+Vector2 glyph_font_measure(Glyph_Font *font, const char *text, float size, float spacing);
+void glyph_font_draw(Glyph_Font *font, const char *text, Vector2 position, float size, float spacing, Color color);
+
+#endif // GLYPHS_H_
@@ -0,0 +1,82 @@
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hash.h"
+
+// The data is consumed in stripes of 8 64 bit lanes. Every lane is mixed with its key by
+// multiplying its halves together and its raw value is added to the neighbouring lane,
+// which is the same accumulation XXH3 does.
+#define HASH_LANES 8
+#define HASH_STRIPE_SIZE (HASH_LANES*sizeof(uint64_t))
+
+static const uint64_t hash_keys[HASH_LANES] = {
+    0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull, 0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+    0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull, 0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull,
+};
+
+static void accumulate_scalar(uint64_t acc[HASH_LANES], const uint8_t *stripe) {
+    for (size_t i = 0; i < HASH_LANES; ++i) {
+        uint64_t value;
+        memcpy(&value, stripe + i*sizeof(uint64_t), sizeof(value));
+        uint64_t keyed = value ^ hash_keys[i];
+        acc[i^1] += value;
+        acc[i] += (keyed & 0xFFFFFFFF)*(keyed >> 32);
+    }
+}
+
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hash_bytes(const void *data, size_t size) {
+    const uint8_t *bytes = data;
+    size_t stripes = size/HASH_STRIPE_SIZE;
+    uint64_t acc[HASH_LANES] = {0};
+
+#ifdef __SSE2__
+    __m128i vacc[HASH_LANES/2];
+    __m128i vkeys[HASH_LANES/2];
+    for (size_t i = 0; i < HASH_LANES/2; ++i) {
+        vacc[i] = _mm_setzero_si128();
+        vkeys[i] = _mm_loadu_si128((const __m128i*)&hash_keys[i*2]);
+    }
+    for (size_t s = 0; s < stripes; ++s) {
+        const __m128i *stripe = (const __m128i*)(bytes + s*HASH_STRIPE_SIZE);
+        for (size_t i = 0; i < HASH_LANES/2; ++i) {
+            __m128i value = _mm_loadu_si128(stripe + i);
+            __m128i keyed = _mm_xor_si128(value, vkeys[i]);
+            __m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+            __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            vacc[i] = _mm_add_epi64(vacc[i], _mm_add_epi64(product, swapped));
+        }
+    }
+    for (size_t i = 0; i < HASH_LANES/2; ++i) {
+        _mm_storeu_si128((__m128i*)&acc[i*2], vacc[i]);
+    }
+#else
+    for (size_t s = 0; s < stripes; ++s) {
+        accumulate_scalar(acc, bytes + s*HASH_STRIPE_SIZE);
+    }
+#endif
+
+    size_t rest = size - stripes*HASH_STRIPE_SIZE;
+    if (rest > 0) {
+        uint8_t stripe[HASH_STRIPE_SIZE] = {0};
+        memcpy(stripe, bytes + stripes*HASH_STRIPE_SIZE, rest);
+        accumulate_scalar(acc, stripe);
+    }
+
+    uint64_t h = size*0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < HASH_LANES; ++i) {
+        h = mix(h ^ acc[i]);
+    }
+    return h;
+}
@@ -0,0 +1,11 @@
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fast non-cryptographic 64 bit hash of a memory block, good enough to tell whether two
+// rendered frames differ. Uses SSE2 when available; the scalar fallback gives the same result.
+uint64_t hash_bytes(const void *data, size_t size);
+
+#endif // HASH_H_
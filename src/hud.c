@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <raylib.h>
+#include <rlgl.h>
+
+#include "hud.h"
+#include "gl.h"
+
+// The timer queries are read a few frames later, so the HUD never waits for the GPU
+#define HUD_QUERIES 4
+#define HUD_FONT_SIZE 20
+#define HUD_PADDING 10
+#define HUD_GRAPH_HEIGHT 120
+// The height of the graph in milliseconds, twice the budget of a 60 fps frame
+#define HUD_GRAPH_MS 33.3f
+
+typedef struct {
+    float stages[COUNT_HUD_STAGES]; // Milliseconds
+} Hud_Frame;
+
+struct Hud {
+    Hud_Frame frames[HUD_HISTORY];
+    size_t frames_count;
+    size_t frame;  // The frame that is being recorded
+    double last_mark;
+    bool in_frame;
+
+    unsigned int queries[HUD_QUERIES];
+    size_t queries_begun;
+    size_t queries_read;
+    float gpu_ms;
+
+    size_t draw_calls;
+    size_t vertices;
+};
+
+static void (*original_draw_arrays)(unsigned int mode, int first, int count) = NULL;
+static void (*original_draw_elements)(unsigned int mode, int count, unsigned int type, const void *indices) = NULL;
+static size_t counted_draw_calls = 0;
+static size_t counted_vertices = 0;
+
+static void counting_draw_arrays(unsigned int mode, int first, int count) {
+    counted_draw_calls += 1;
+    counted_vertices += count;
+    original_draw_arrays(mode, first, count);
+}
+
+// rlgl draws its quads as 6 indices of 4 vertices
+static void counting_draw_elements(unsigned int mode, int count, unsigned int type, const void *indices) {
+    counted_draw_calls += 1;
+    counted_vertices += count/6*4;
+    original_draw_elements(mode, count, type, indices);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+Hud *hud_create(void) {
+    Hud *hud = calloc(1, sizeof(*hud));
+    if (hud == NULL) return NULL;
+    glGenQueries(HUD_QUERIES, hud->queries);
+    if (original_draw_arrays == NULL) {
+        original_draw_arrays = glad_glDrawArrays;
+        original_draw_elements = glad_glDrawElements;
+        glad_glDrawArrays = counting_draw_arrays;
+        glad_glDrawElements = counting_draw_elements;
+    }
+    return hud;
+}
+
+// The counting hooks are process-wide, so the rest of the program gets the functions of glad back
+void hud_destroy(Hud *hud) {
+    if (hud == NULL) return;
+    glDeleteQueries(HUD_QUERIES, hud->queries);
+    if (original_draw_arrays != NULL) {
+        glad_glDrawArrays = original_draw_arrays;
+        glad_glDrawElements = original_draw_elements;
+        original_draw_arrays = NULL;
+        original_draw_elements = NULL;
+    }
+    free(hud);
+}
+
+// Picks up the results of the queries that are ready without waiting for the rest
+static void read_queries(Hud *hud) {
+    while (hud->queries_read < hud->queries_begun) {
+        unsigned int query = hud->queries[hud->queries_read%HUD_QUERIES];
+        int available = 0;
+        // A query that is about to be reused has to be read no matter what
+        if (hud->queries_begun - hud->queries_read < HUD_QUERIES) {
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+        }
+        uint64_t ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+        hud->gpu_ms = ns*1e-6f;
+        hud->queries_read += 1;
+    }
+}
+
+void hud_frame_begin(Hud *hud) {
+    // The query of a frame that never got to hud_scene_end() is still running
+    if (hud->in_frame) glEndQuery(GL_TIME_ELAPSED);
+
+    double t = now();
+    if (hud->frames_count > 0) {
+        // The previous frame only ends here, after the buffers were swapped
+        hud->frames[hud->frame].stages[HUD_STAGE_REST] = (t - hud->last_mark)*1000.0f;
+        hud->frame = (hud->frame + 1)%HUD_HISTORY;
+    }
+    if (hud->frames_count < HUD_HISTORY) hud->frames_count += 1;
+    hud->frames[hud->frame] = (Hud_Frame) {0};
+    hud->last_mark = t;
+    hud->in_frame = true;
+
+    read_queries(hud);
+    glBeginQuery(GL_TIME_ELAPSED, hud->queries[hud->queries_begun%HUD_QUERIES]);
+    hud->queries_begun += 1;
+    counted_draw_calls = 0;
+    counted_vertices = 0;
+}
+
+void hud_mark(Hud *hud, Hud_Stage stage) {
+    double t = now();
+    hud->frames[hud->frame].stages[stage] += (t - hud->last_mark)*1000.0f;
+    hud->last_mark = t;
+}
+
+void hud_scene_end(Hud *hud) {
+    if (!hud->in_frame) return;
+    rlDrawRenderBatchActive();
+    glEndQuery(GL_TIME_ELAPSED);
+    hud_mark(hud, HUD_STAGE_SUBMIT);
+    hud->draw_calls = counted_draw_calls;
+    hud->vertices = counted_vertices;
+    hud->in_frame = false;
+}
+
+static void draw_line(Vector2 *position, Color color, const char *text) {
+    DrawText(text, position->x, position->y, HUD_FONT_SIZE, color);
+    position->y += HUD_FONT_SIZE + 4;
+}
+
+static const char *human_bytes(size_t bytes) {
+    if (bytes >= 1024*1024) return TextFormat("%.1f MiB", bytes/(1024.0f*1024.0f));
+    if (bytes >= 1024) return TextFormat("%.1f KiB", bytes/1024.0f);
+    return TextFormat("%zu B", bytes);
+}
+
+void hud_draw(Hud *hud, const Plug_Stats *stats) {
+    if (hud->frames_count == 0) return;
+
+    // The averages go over the frames that are finished, the current one has no REST yet
+    float average[COUNT_HUD_STAGES] = {0};
+    size_t finished = hud->frames_count - 1;
+    for (size_t i = 1; i <= finished; ++i) {
+        const Hud_Frame *frame = &hud->frames[(hud->frame + HUD_HISTORY - i)%HUD_HISTORY];
+        for (size_t s = 0; s < COUNT_HUD_STAGES; ++s) average[s] += frame->stages[s];
+    }
+    float total = 0.0f;
+    for (size_t s = 0; s < COUNT_HUD_STAGES; ++s) {
+        if (finished > 0) average[s] /= finished;
+        total += average[s];
+    }
+
+    float width = HUD_HISTORY*2;
+    float height = HUD_GRAPH_HEIGHT + (HUD_FONT_SIZE + 4)*(COUNT_HUD_STAGES + 5) + HUD_PADDING*3;
+    Vector2 origin = {HUD_PADDING, HUD_PADDING};
+    DrawRectangleV(origin, (Vector2) {width + HUD_PADDING*2, height}, ColorAlpha(BLACK, 0.75f));
+
+    // The graph of the finished frames from the oldest on the left to the newest on the right
+    static const Color stage_colors[COUNT_HUD_STAGES] = {
+#define STAGE(name, label, color) color,
+        LIST_OF_HUD_STAGES
+#undef STAGE
+    };
+    static const char *stage_labels[COUNT_HUD_STAGES] = {
+#define STAGE(name, label, ...) label,
+        LIST_OF_HUD_STAGES
+#undef STAGE
+    };
+    float graph_bottom = origin.y + HUD_PADDING + HUD_GRAPH_HEIGHT;
+    for (size_t i = 1; i <= finished; ++i) {
+        const Hud_Frame *frame = &hud->frames[(hud->frame + HUD_HISTORY - i)%HUD_HISTORY];
+        float x = origin.x + HUD_PADDING + width - i*2;
+        float y = graph_bottom;
+        for (size_t s = 0; s < COUNT_HUD_STAGES; ++s) {
+            float h = frame->stages[s]/HUD_GRAPH_MS*HUD_GRAPH_HEIGHT;
+            if (y - h < graph_bottom - HUD_GRAPH_HEIGHT) h = y - (graph_bottom - HUD_GRAPH_HEIGHT);
+            DrawRectangleV((Vector2) {x, y - h}, (Vector2) {2, h}, stage_colors[s]);
+            y -= h;
+        }
+    }
+    float budget_y = graph_bottom - 1000.0f/60.0f/HUD_GRAPH_MS*HUD_GRAPH_HEIGHT;
+    DrawLineV((Vector2) {origin.x + HUD_PADDING, budget_y}, (Vector2) {origin.x + HUD_PADDING + width, budget_y}, ColorAlpha(GREEN, 0.6f));
+
+    Vector2 position = {origin.x + HUD_PADDING, graph_bottom + HUD_PADDING};
+    draw_line(&position, RAYWHITE, TextFormat("Frame: %.2f ms (%.0f FPS)", total, total > 0.0f ? 1000.0f/total : 0.0f));
+    for (size_t s = 0; s < COUNT_HUD_STAGES; ++s) {
+        draw_line(&position, stage_colors[s], TextFormat("  %-7s %.2f ms", stage_labels[s], average[s]));
+    }
+    draw_line(&position, RAYWHITE, TextFormat("GPU: %.2f ms", hud->gpu_ms));
+    draw_line(&position, RAYWHITE, TextFormat("Draw calls: %zu, vertices: %zu", hud->draw_calls, hud->vertices));
+    if (stats) {
+        // TextFormat() rotates its buffers, so it survives being nested like this
+        draw_line(&position, RAYWHITE, TextFormat("Arenas: %s of %s in %zu regions",
+                                                  human_bytes(stats->arena_bytes),
+                                                  human_bytes(stats->arena_capacity),
+                                                  stats->arena_regions));
+        draw_line(&position, RAYWHITE, TextFormat("Tasks: %zu updated, %zu running", stats->tasks_updated, stats->tasks_running));
+    } else {
+        draw_line(&position, GRAY, "The animation does not report its arenas and tasks");
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef HUD_H_
+#define HUD_H_
+
+#include <stdbool.h>
+#include <raylib.h>
+
+#include "env.h"
+
+// Performance overlay of the preview. Shows where the CPU time of the recent frames went, the
+// GPU time of the scene from timer queries, the draw calls rlgl made and what the animation
+// reports about its memory and tasks.
+
+#define HUD_HISTORY 240
+
+#define LIST_OF_HUD_STAGES \
+    STAGE(UPDATE, "update", ORANGE) /* plug_update() building the draw calls */ \
+    STAGE(SUBMIT, "submit", PURPLE) /* Handing the rest of the rlgl batch to the driver */ \
+    STAGE(REST, "rest", DARKGRAY)   /* The overlays, swapping the buffers and waiting for the next frame */ \
+
+typedef enum {
+#define STAGE(name, ...) HUD_STAGE_##name,
+    LIST_OF_HUD_STAGES
+#undef STAGE
+    COUNT_HUD_STAGES,
+} Hud_Stage;
+
+typedef struct Hud Hud;
+
+// Starts counting the draw calls, so it needs the OpenGL context
+Hud *hud_create(void);
+void hud_destroy(Hud *hud);
+// Brackets the scene of a frame: hud_frame_begin(), plug_update(), hud_mark(HUD_STAGE_UPDATE),
+// hud_scene_end(). The time until the next hud_frame_begin() goes to HUD_STAGE_REST.
+void hud_frame_begin(Hud *hud);
+void hud_mark(Hud *hud, Hud_Stage stage);
+// Submits the batch of the scene, so the draw calls and the GPU time don't include the overlays
+void hud_scene_end(Hud *hud);
+// stats is NULL when the animation does not report them
+void hud_draw(Hud *hud, const Plug_Stats *stats);
+
+#endif // HUD_H_
@@ -0,0 +1,148 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "metrics.h"
+
+#define METRICS_RING_CAPACITY 1024
+
+static const char *stage_names[COUNT_METRICS_STAGES] = {
+#define STAGE(name, display_name) [METRICS_STAGE_##name] = display_name,
+    LIST_OF_METRICS_STAGES
+#undef STAGE
+};
+
+typedef struct {
+    double start;
+    double stages[COUNT_METRICS_STAGES];
+} Metrics_Frame;
+
+struct Metrics {
+    FILE *csv;
+    size_t frames_total;
+    double start;
+
+    bool in_frame;
+    double last_mark;
+    Metrics_Frame ring[METRICS_RING_CAPACITY];
+    size_t ring_count;
+
+    size_t frames;
+    double stage_sums[COUNT_METRICS_STAGES];
+    double stage_maxs[COUNT_METRICS_STAGES];
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static void metrics_flush(Metrics *m) {
+    if (m->csv != NULL) {
+        size_t first = m->frames - m->ring_count;
+        for (size_t i = 0; i < m->ring_count; ++i) {
+            Metrics_Frame *frame = &m->ring[i];
+            fprintf(m->csv, "%zu,%.3f", first + i, (frame->start - m->start)*1000.0);
+            for (size_t j = 0; j < COUNT_METRICS_STAGES; ++j) {
+                fprintf(m->csv, ",%.3f", frame->stages[j]*1000.0);
+            }
+            fprintf(m->csv, "\n");
+        }
+    }
+    m->ring_count = 0;
+}
+
+Metrics *metrics_create(const char *csv_path, size_t frames_total) {
+    Metrics *m = malloc(sizeof(Metrics));
+    assert(m != NULL && "Buy MORE RAM lol!!");
+    memset(m, 0, sizeof(*m));
+    m->frames_total = frames_total;
+    m->start = now();
+
+    if (csv_path != NULL) {
+        m->csv = fopen(csv_path, "w");
+        if (m->csv == NULL) {
+            fprintf(stderr, "ERROR: could not open %s for the export metrics\n", csv_path);
+        } else {
+            fprintf(m->csv, "frame,start_ms");
+            for (size_t j = 0; j < COUNT_METRICS_STAGES; ++j) {
+                fprintf(m->csv, ",%s_ms", stage_names[j]);
+            }
+            fprintf(m->csv, "\n");
+        }
+    }
+    return m;
+}
+
+void metrics_destroy(Metrics *m) {
+    if (m == NULL) return;
+    metrics_flush(m);
+    if (m->csv != NULL) fclose(m->csv);
+    free(m);
+}
+
+void metrics_frame_begin(Metrics *m) {
+    if (m == NULL) return;
+    if (m->ring_count >= METRICS_RING_CAPACITY) metrics_flush(m);
+    Metrics_Frame *frame = &m->ring[m->ring_count];
+    memset(frame, 0, sizeof(*frame));
+    frame->start = now();
+    m->last_mark = frame->start;
+    m->in_frame = true;
+}
+
+void metrics_mark(Metrics *m, Metrics_Stage stage) {
+    // Marks outside of a frame, e.g. while flushing the readback ring at the end, are not frames of their own
+    if (m == NULL || !m->in_frame) return;
+    double t = now();
+    m->ring[m->ring_count].stages[stage] += t - m->last_mark;
+    m->last_mark = t;
+}
+
+void metrics_frame_end(Metrics *m) {
+    if (m == NULL || !m->in_frame) return;
+    Metrics_Frame *frame = &m->ring[m->ring_count];
+    for (size_t j = 0; j < COUNT_METRICS_STAGES; ++j) {
+        m->stage_sums[j] += frame->stages[j];
+        if (frame->stages[j] > m->stage_maxs[j]) m->stage_maxs[j] = frame->stages[j];
+    }
+    m->ring_count += 1;
+    m->frames += 1;
+    m->in_frame = false;
+}
+
+void metrics_print_progress(Metrics *m, FILE *stream, bool overwrite) {
+    double elapsed = now() - m->start;
+    double fps = elapsed > 0.0 ? m->frames/elapsed : 0.0;
+
+    if (m->frames_total > 0) {
+        size_t left = m->frames_total > m->frames ? m->frames_total - m->frames : 0;
+        double eta = fps > 0.0 ? left/fps : 0.0;
+        fprintf(stream, "%sFrame %zu/%zu (%.1f%%), %.1f fps, ETA %02d:%02d |", overwrite ? "\r" : "",
+                m->frames, m->frames_total, 100.0*m->frames/m->frames_total, fps, (int)eta/60, (int)eta%60);
+    } else {
+        fprintf(stream, "%sFrame %zu, %.1f fps |", overwrite ? "\r" : "", m->frames, fps);
+    }
+    for (size_t j = 0; j < COUNT_METRICS_STAGES; ++j) {
+        double average = m->frames > 0 ? m->stage_sums[j]/m->frames : 0.0;
+        fprintf(stream, " %s %.2fms", stage_names[j], average*1000.0);
+    }
+    fprintf(stream, overwrite ? "\x1b[K" : "\n");
+    fflush(stream);
+}
+
+void metrics_print_summary(Metrics *m, FILE *stream) {
+    double elapsed = now() - m->start;
+    fprintf(stream, "Exported %zu frames in %.2fs (%.2f fps)\n", m->frames, elapsed, elapsed > 0.0 ? m->frames/elapsed : 0.0);
+    fprintf(stream, "    %-10s %10s %10s %10s %6s\n", "stage", "total", "average", "max", "share");
+    double frames_sum = 0.0;
+    for (size_t j = 0; j < COUNT_METRICS_STAGES; ++j) frames_sum += m->stage_sums[j];
+    for (size_t j = 0; j < COUNT_METRICS_STAGES; ++j) {
+        double average = m->frames > 0 ? m->stage_sums[j]/m->frames : 0.0;
+        double share = frames_sum > 0.0 ? 100.0*m->stage_sums[j]/frames_sum : 0.0;
+        fprintf(stream, "    %-10s %9.2fs %8.2fms %8.2fms %5.1f%%\n",
+                stage_names[j], m->stage_sums[j], average*1000.0, m->stage_maxs[j]*1000.0, share);
+    }
+}
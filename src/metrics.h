@@ -0,0 +1,40 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+// Per-frame timing of the export pipeline. The frames are recorded into a fixed ring
+// that is flushed into a CSV file whenever it fills up, so recording a stage costs one
+// clock_gettime() and an addition.
+
+#define LIST_OF_METRICS_STAGES \
+    STAGE(UPDATE, "update")     /* plug_update() and submitting its draw calls */ \
+    STAGE(SOUND, "sound")       /* Writing the sound samples into ffmpeg */ \
+    STAGE(CONVERT, "convert")   /* Converting the frame to I420 on the GPU */ \
+    STAGE(READBACK, "readback") /* Queueing and waiting for the pixels of the frames */ \
+    STAGE(HASH, "hash")         /* Looking for repeated frames */ \
+    STAGE(SEND, "send")         /* Handing the frames to the ffmpeg writer, blocks when ffmpeg lags */ \
+
+typedef enum {
+#define STAGE(name, ...) METRICS_STAGE_##name,
+    LIST_OF_METRICS_STAGES
+#undef STAGE
+    COUNT_METRICS_STAGES,
+} Metrics_Stage;
+
+typedef struct Metrics Metrics;
+
+// csv_path may be NULL to only keep the totals. frames_total is 0 when it's unknown.
+Metrics *metrics_create(const char *csv_path, size_t frames_total);
+void metrics_destroy(Metrics *m);
+void metrics_frame_begin(Metrics *m);
+// Attributes the time since the previous mark (or the beginning of the frame) to the stage
+void metrics_mark(Metrics *m, Metrics_Stage stage);
+void metrics_frame_end(Metrics *m);
+// One line of progress: frames, frames per second, ETA and the average cost of the stages
+void metrics_print_progress(Metrics *m, FILE *stream, bool overwrite);
+void metrics_print_summary(Metrics *m, FILE *stream);
+
+#endif // METRICS_H_
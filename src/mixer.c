@@ -0,0 +1,256 @@
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "mixer.h"
+
+// The output is mixed in blocks, so the accumulator does not depend on the size of the request
+#define MIXER_BLOCK_FRAMES 1024
+
+typedef struct {
+    const int16_t *samples;
+    Sound_Stream *stream; // Stays set after the stream finishes until mixer_update() closes it
+    size_t frame_count;
+    size_t channels;
+    size_t cursor;        // Of a stream, the frames that passed since it started even when it ran dry
+    float gain_left;
+    float gain_right;
+    bool playing;
+} Mixer_Voice;
+
+struct Mixer {
+    pthread_mutex_t lock;
+    Mixer_Voice voices[MIXER_MAX_VOICES];
+    float acc[MIXER_BLOCK_FRAMES*2];
+    int16_t scratch[MIXER_BLOCK_FRAMES*2]; // The samples read out of a stream
+};
+
+Mixer *mixer_create(void) {
+    Mixer *mixer = calloc(1, sizeof(*mixer));
+    if (mixer == NULL) return NULL;
+    pthread_mutex_init(&mixer->lock, NULL);
+    return mixer;
+}
+
+void mixer_destroy(Mixer *mixer) {
+    if (mixer == NULL) return;
+    mixer_stop_all(mixer);
+    mixer_update(mixer);
+    pthread_mutex_destroy(&mixer->lock);
+    free(mixer);
+}
+
+// Must be called with the lock held. The voice that played the longest makes room when all of them
+// are busy. Its stream is handed back in `evicted`, to be closed once the lock is released.
+static Mixer_Voice *take_voice(Mixer *mixer, Sound_Stream **evicted) {
+    Mixer_Voice *voice = NULL;
+    for (size_t i = 0; i < MIXER_MAX_VOICES; ++i) {
+        if (!mixer->voices[i].playing) {
+            voice = &mixer->voices[i];
+            break;
+        }
+        if (voice == NULL || mixer->voices[i].cursor > voice->cursor) {
+            voice = &mixer->voices[i];
+        }
+    }
+    *evicted = voice->stream;
+    voice->stream = NULL;
+    return voice;
+}
+
+// Panning only attenuates the opposite side, so a centered sound plays at its own volume
+static void voice_pan(Mixer_Voice *voice, float gain, float pan) {
+    if (pan < -1.0f) pan = -1.0f;
+    if (pan > 1.0f) pan = 1.0f;
+    voice->gain_left = gain*(pan > 0.0f ? 1.0f - pan : 1.0f);
+    voice->gain_right = gain*(pan < 0.0f ? 1.0f + pan : 1.0f);
+}
+
+bool mixer_play(Mixer *mixer, const int16_t *samples, size_t frame_count, size_t channels, float gain, float pan) {
+    if (channels != 1 && channels != 2) return false;
+    if (frame_count == 0) return true;
+
+    Sound_Stream *evicted = NULL;
+    pthread_mutex_lock(&mixer->lock);
+    Mixer_Voice *voice = take_voice(mixer, &evicted);
+    *voice = (Mixer_Voice) {
+        .samples = samples,
+        .frame_count = frame_count,
+        .channels = channels,
+        .playing = true,
+    };
+    voice_pan(voice, gain, pan);
+    pthread_mutex_unlock(&mixer->lock);
+    sound_stream_close(evicted);
+    return true;
+}
+
+bool mixer_play_stream(Mixer *mixer, Sound_Stream *stream, float gain, float pan) {
+    // The first second is read ahead right away, so the stream is heard from its very first frame
+    sound_stream_fill(stream);
+
+    Sound_Stream *evicted = NULL;
+    pthread_mutex_lock(&mixer->lock);
+    Mixer_Voice *voice = take_voice(mixer, &evicted);
+    *voice = (Mixer_Voice) {
+        .stream = stream,
+        .channels = sound_stream_channels(stream),
+        .playing = true,
+    };
+    voice_pan(voice, gain, pan);
+    pthread_mutex_unlock(&mixer->lock);
+    sound_stream_close(evicted);
+    return true;
+}
+
+void mixer_update(Mixer *mixer) {
+    Sound_Stream *streams[MIXER_MAX_VOICES];
+    size_t streams_count = 0;
+    Sound_Stream *finished[MIXER_MAX_VOICES];
+    size_t finished_count = 0;
+
+    pthread_mutex_lock(&mixer->lock);
+    for (size_t i = 0; i < MIXER_MAX_VOICES; ++i) {
+        Mixer_Voice *voice = &mixer->voices[i];
+        if (voice->stream == NULL) continue;
+        if (voice->playing) {
+            streams[streams_count++] = voice->stream;
+        } else {
+            finished[finished_count++] = voice->stream;
+            voice->stream = NULL;
+        }
+    }
+    pthread_mutex_unlock(&mixer->lock);
+
+    // Only this thread closes the streams, so they can be read from the disk and closed without blocking the mixing
+    for (size_t i = 0; i < finished_count; ++i) {
+        sound_stream_close(finished[i]);
+    }
+    for (size_t i = 0; i < streams_count; ++i) {
+        sound_stream_fill(streams[i]);
+    }
+}
+
+static void mix_samples(float *acc, const int16_t *src, const Mixer_Voice *voice, size_t frames) {
+    size_t i = 0;
+    if (voice->channels == 2) {
+#ifdef __SSE2__
+        __m128 gains = _mm_setr_ps(voice->gain_left, voice->gain_right, voice->gain_left, voice->gain_right);
+        for (; i + 4 <= frames; i += 4) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(src + i*2));
+            __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+            __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+            _mm_storeu_ps(acc + i*2 + 0, _mm_add_ps(_mm_loadu_ps(acc + i*2 + 0), _mm_mul_ps(lo, gains)));
+            _mm_storeu_ps(acc + i*2 + 4, _mm_add_ps(_mm_loadu_ps(acc + i*2 + 4), _mm_mul_ps(hi, gains)));
+        }
+#endif
+        for (; i < frames; ++i) {
+            acc[i*2 + 0] += src[i*2 + 0]*voice->gain_left;
+            acc[i*2 + 1] += src[i*2 + 1]*voice->gain_right;
+        }
+    } else {
+#ifdef __SSE2__
+        __m128 gains = _mm_setr_ps(voice->gain_left, voice->gain_right, voice->gain_left, voice->gain_right);
+        for (; i + 4 <= frames; i += 4) {
+            __m128i x = _mm_loadl_epi64((const __m128i*)(src + i));
+            __m128i duplicated = _mm_unpacklo_epi16(x, x);
+            __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(duplicated, duplicated), 16));
+            __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(duplicated, duplicated), 16));
+            _mm_storeu_ps(acc + i*2 + 0, _mm_add_ps(_mm_loadu_ps(acc + i*2 + 0), _mm_mul_ps(lo, gains)));
+            _mm_storeu_ps(acc + i*2 + 4, _mm_add_ps(_mm_loadu_ps(acc + i*2 + 4), _mm_mul_ps(hi, gains)));
+        }
+#endif
+        for (; i < frames; ++i) {
+            acc[i*2 + 0] += src[i]*voice->gain_left;
+            acc[i*2 + 1] += src[i]*voice->gain_right;
+        }
+    }
+}
+
+static void clip(int16_t *output, const float *acc, size_t count) {
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128 max = _mm_set1_ps(32767.0f);
+    __m128 min = _mm_set1_ps(-32768.0f);
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_loadu_ps(acc + i + 0), max), min));
+        __m128i hi = _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_loadu_ps(acc + i + 4), max), min));
+        _mm_storeu_si128((__m128i*)(output + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+    for (; i < count; ++i) {
+        float x = acc[i];
+        if (x > 32767.0f) x = 32767.0f;
+        if (x < -32768.0f) x = -32768.0f;
+        output[i] = lrintf(x);
+    }
+}
+
+static void advance(Mixer *mixer, int16_t *output, size_t frame_count) {
+    while (frame_count > 0) {
+        size_t block = frame_count < MIXER_BLOCK_FRAMES ? frame_count : MIXER_BLOCK_FRAMES;
+        if (output) {
+            for (size_t i = 0; i < block*2; ++i) mixer->acc[i] = 0.0f;
+        }
+        for (size_t i = 0; i < MIXER_MAX_VOICES; ++i) {
+            Mixer_Voice *voice = &mixer->voices[i];
+            if (!voice->playing) continue;
+            if (voice->stream) {
+                // A stream that ran dry before its end stays silent until it is read ahead again
+                if (output) {
+                    size_t frames = sound_stream_read(voice->stream, mixer->scratch, block);
+                    mix_samples(mixer->acc, mixer->scratch, voice, frames);
+                } else {
+                    sound_stream_skip(voice->stream, block);
+                }
+                voice->cursor += block;
+                if (sound_stream_finished(voice->stream)) voice->playing = false;
+                continue;
+            }
+            size_t frames = voice->frame_count - voice->cursor;
+            if (frames > block) frames = block;
+            if (output) mix_samples(mixer->acc, voice->samples + voice->cursor*voice->channels, voice, frames);
+            voice->cursor += frames;
+            if (voice->cursor >= voice->frame_count) voice->playing = false;
+        }
+        if (output) {
+            clip(output, mixer->acc, block*2);
+            output += block*2;
+        }
+        frame_count -= block;
+    }
+}
+
+void mixer_mix(Mixer *mixer, int16_t *output, size_t frame_count) {
+    pthread_mutex_lock(&mixer->lock);
+    advance(mixer, output, frame_count);
+    pthread_mutex_unlock(&mixer->lock);
+}
+
+void mixer_skip(Mixer *mixer, size_t frame_count) {
+    pthread_mutex_lock(&mixer->lock);
+    advance(mixer, NULL, frame_count);
+    pthread_mutex_unlock(&mixer->lock);
+}
+
+void mixer_stop_all(Mixer *mixer) {
+    pthread_mutex_lock(&mixer->lock);
+    for (size_t i = 0; i < MIXER_MAX_VOICES; ++i) {
+        mixer->voices[i].playing = false;
+    }
+    pthread_mutex_unlock(&mixer->lock);
+}
+
+size_t mixer_voices_playing(Mixer *mixer) {
+    pthread_mutex_lock(&mixer->lock);
+    size_t count = 0;
+    for (size_t i = 0; i < MIXER_MAX_VOICES; ++i) {
+        if (mixer->voices[i].playing) count += 1;
+    }
+    pthread_mutex_unlock(&mixer->lock);
+    return count;
+}
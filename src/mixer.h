@@ -0,0 +1,41 @@
+#ifndef MIXER_H_
+#define MIXER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stream.h"
+
+// Mixes any number of overlapping sounds into a single 16 bit stereo stream. The voices are
+// accumulated in float and clipped once at the end. Uses SSE2 when available; the scalar
+// fallback gives the same result. Both the export and the preview play through it, so they
+// sound the same.
+//
+// The mixer is thread-safe: the preview mixes on the audio thread while the animation starts
+// the sounds on the main one. All the calls but mixer_mix() must come from the same thread.
+
+// Once all the voices are busy a new sound replaces the one that has been playing the longest
+#define MIXER_MAX_VOICES 64
+
+typedef struct Mixer Mixer;
+
+Mixer *mixer_create(void);
+void mixer_destroy(Mixer *mixer);
+// Starts playing 16 bit mono or stereo `samples`. The mixer does not copy them, they must stay
+// alive until the sound finishes. `pan` goes from -1.0 (left) through 0.0 (center) to 1.0 (right).
+bool mixer_play(Mixer *mixer, const int16_t *samples, size_t frame_count, size_t channels, float gain, float pan);
+// Starts playing a stream of the sample rate of the output. The mixer owns the stream from now
+// on and closes it once it finishes.
+bool mixer_play_stream(Mixer *mixer, Sound_Stream *stream, float gain, float pan);
+// Reads the playing streams ahead and closes the finished ones. Must be called at least once
+// per SOUND_STREAM_RING_FRAMES mixed frames, or the streams run dry.
+void mixer_update(Mixer *mixer);
+// Mixes the next `frame_count` stereo frames of all the playing voices into `output`
+void mixer_mix(Mixer *mixer, int16_t *output, size_t frame_count);
+// Advances all the playing voices without mixing them
+void mixer_skip(Mixer *mixer, size_t frame_count);
+void mixer_stop_all(Mixer *mixer);
+size_t mixer_voices_playing(Mixer *mixer);
+
+#endif // MIXER_H_
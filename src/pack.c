@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <raylib.h>
+
+#include "pack.h"
+
+// What LoadFontEx() of raylib rasterizes the fonts with
+#define PACK_FONT_GLYPH_PADDING 4
+
+struct Pack {
+    const uint8_t *data;
+    size_t size;
+    const Pack_Entry *entries;
+    size_t entries_count;
+};
+
+static bool pack_has(const Pack *pack, uint64_t offset, uint64_t size) {
+    return offset <= pack->size && size <= pack->size - offset;
+}
+
+static bool pack_has_cstr(const Pack *pack, uint64_t offset) {
+    return offset < pack->size && memchr(pack->data + offset, '\0', pack->size - offset) != NULL;
+}
+
+// The pack comes from the disk, so nothing it points to is trusted before it is checked once here
+static bool pack_entry_is_valid(const Pack *pack, const Pack_Entry *entry) {
+    if (!pack_has_cstr(pack, entry->path)) return false;
+    if (entry->codepoints != 0 && !pack_has_cstr(pack, entry->codepoints)) return false;
+    if (!pack_has(pack, entry->data, entry->data_size)) return false;
+    switch (entry->kind) {
+        case PACK_FONT:
+            if (entry->glyphs_count < 0 || entry->glyphs%_Alignof(Pack_Glyph) != 0) return false;
+            if (!pack_has(pack, entry->glyphs, (uint64_t)entry->glyphs_count*sizeof(Pack_Glyph))) return false;
+            // fallthrough
+        case PACK_TEXTURE: {
+            if (entry->width <= 0 || entry->height <= 0 || entry->mipmaps <= 0) return false;
+            uint64_t size = 0;
+            int width = entry->width, height = entry->height;
+            for (int i = 0; i < entry->mipmaps; ++i) {
+                size += GetPixelDataSize(width, height, entry->format);
+                if (width > 1) width /= 2;
+                if (height > 1) height /= 2;
+            }
+            return size == entry->data_size;
+        }
+        case PACK_WAVE:
+            return (uint64_t)entry->frame_count*entry->channels*(entry->sample_size/8) == entry->data_size;
+        default:
+            return false;
+    }
+}
+
+Pack *pack_open(const char *file_path) {
+    int fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    Pack *pack = NULL;
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) < 0 || (size_t)statbuf.st_size < sizeof(Pack_Header)) {
+        TraceLog(LOG_WARNING, "PACK: %s is not an asset pack", file_path);
+        goto defer;
+    }
+
+    void *data = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        TraceLog(LOG_WARNING, "PACK: could not map %s: %s", file_path, strerror(errno));
+        goto defer;
+    }
+
+    pack = calloc(1, sizeof(*pack));
+    pack->data = data;
+    pack->size = statbuf.st_size;
+
+    const Pack_Header *header = data;
+    if (memcmp(header->magic, PACK_MAGIC, sizeof(header->magic)) != 0 || header->version != PACK_VERSION) {
+        TraceLog(LOG_WARNING, "PACK: %s is not an asset pack of version %d, bake it again with ./nob --pack", file_path, PACK_VERSION);
+        goto fail;
+    }
+    if (header->entries%_Alignof(Pack_Entry) != 0 || !pack_has(pack, header->entries, (uint64_t)header->entries_count*sizeof(Pack_Entry))) {
+        TraceLog(LOG_WARNING, "PACK: the table of %s is out of bounds", file_path);
+        goto fail;
+    }
+    pack->entries = (const Pack_Entry*)(pack->data + header->entries);
+    pack->entries_count = header->entries_count;
+    for (size_t i = 0; i < pack->entries_count; ++i) {
+        if (!pack_entry_is_valid(pack, &pack->entries[i])) {
+            TraceLog(LOG_WARNING, "PACK: entry %zu of %s is corrupted", i, file_path);
+            goto fail;
+        }
+    }
+
+    TraceLog(LOG_INFO, "PACK: mapped %zu assets of %s", pack->entries_count, file_path);
+    goto defer;
+
+fail:
+    pack_close(pack);
+    pack = NULL;
+defer:
+    close(fd);
+    return pack;
+}
+
+void pack_close(Pack *pack) {
+    if (pack == NULL) return;
+    munmap((void*)pack->data, pack->size);
+    free(pack);
+}
+
+const Pack_Entry *pack_find(const Pack *pack, Pack_Kind kind, const char *file_path, int font_size, const char *codepoints) {
+    if (pack == NULL) return NULL;
+    for (size_t i = 0; i < pack->entries_count; ++i) {
+        const Pack_Entry *entry = &pack->entries[i];
+        if (entry->kind != kind || strcmp(pack_at(pack, entry->path), file_path) != 0) continue;
+        if (kind == PACK_FONT) {
+            if (entry->font_size != font_size) continue;
+            if (entry->codepoints == 0 || codepoints == NULL) {
+                if (entry->codepoints != 0 || codepoints != NULL) continue;
+            } else if (strcmp(pack_at(pack, entry->codepoints), codepoints) != 0) {
+                continue;
+            }
+        }
+        return entry;
+    }
+    return NULL;
+}
+
+const void *pack_at(const Pack *pack, uint64_t offset) {
+    return pack->data + offset;
+}
+
+bool pack_contains(const Pack *pack, const void *ptr) {
+    if (pack == NULL) return false;
+    const uint8_t *p = ptr;
+    return p >= pack->data && p < pack->data + pack->size;
+}
+
+// The same steps LoadFontEx() takes, only without uploading the atlas
+bool pack_rasterize_font(const char *file_path, int font_size, const char *codepoints, Pack_Font *font) {
+    int data_size = 0;
+    unsigned char *data = LoadFileData(file_path, &data_size);
+    if (data == NULL) return false;
+
+    int codepoints_count = 0;
+    int *codepoints_array = codepoints ? LoadCodepoints(codepoints, &codepoints_count) : NULL;
+    int glyphs_count = codepoints_count > 0 ? codepoints_count : 95;
+    GlyphInfo *glyphs = LoadFontData(data, data_size, font_size, codepoints_array, glyphs_count, FONT_DEFAULT);
+    UnloadCodepoints(codepoints_array);
+    UnloadFileData(data);
+    if (glyphs == NULL) return false;
+
+    Rectangle *recs = NULL;
+    Image atlas = GenImageFontAtlas(glyphs, &recs, glyphs_count, font_size, PACK_FONT_GLYPH_PADDING, 0);
+    if (atlas.data == NULL) {
+        MemFree(recs);
+        UnloadFontData(glyphs, glyphs_count);
+        return false;
+    }
+
+    *font = (Pack_Font) {
+        .glyphs = glyphs,
+        .recs = recs,
+        .glyphs_count = glyphs_count,
+        .glyph_padding = PACK_FONT_GLYPH_PADDING,
+        .atlas = atlas,
+    };
+    return true;
+}
@@ -0,0 +1,95 @@
+#ifndef PACK_H_
+#define PACK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <raylib.h>
+
+// The asset pack that `./nob --pack` bakes with build/packer from the list in assets/pack.txt.
+// Everything in it is ready for the GPU and the mixer: the fonts are rasterized into atlases,
+// the images are decoded with all their mipmaps and the sounds are converted to the format of
+// the export. panim maps it into memory and the asset cache uploads straight out of it.
+//
+// Layout: Pack_Header, then the paths, the pixels, the samples and the glyphs at the offsets
+// the entries point to, then the table of Pack_Entry. All the offsets are from the start of the file.
+
+#define PACK_MAGIC "PANIMPAK"
+#define PACK_VERSION 3
+// Of the pixels and the samples, so they can be handed to the driver and the mixer as they are
+#define PACK_ALIGNMENT 64
+
+typedef enum {
+    PACK_FONT,
+    PACK_TEXTURE,
+    PACK_WAVE,
+} Pack_Kind;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t entries_count;
+    uint64_t entries;
+} Pack_Header;
+
+typedef struct {
+    int32_t value;
+    int32_t offset_x;
+    int32_t offset_y;
+    int32_t advance_x;
+    float x, y, width, height; // Where the glyph is in the atlas
+} Pack_Glyph;
+
+typedef struct {
+    uint32_t kind;
+    int32_t font_size;
+    uint64_t path;       // NUL-terminated, exactly as the plugins load it
+    uint64_t codepoints; // NUL-terminated UTF-8 characters of the font, 0 for the default ones
+    // Of the source file when it was baked, a file that changed since then is loaded from the disk
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t data;       // The pixels of all the mipmaps one after another or the samples
+    uint64_t data_size;
+
+    // Textures and the atlases of the fonts
+    int32_t width;
+    int32_t height;
+    int32_t mipmaps;
+    int32_t format;      // PixelFormat of raylib
+    // Fonts
+    int32_t glyphs_count;
+    int32_t glyph_padding;
+    uint64_t glyphs;     // Pack_Glyph[glyphs_count]
+    // Waves
+    uint32_t frame_count;
+    uint32_t sample_rate;
+    uint32_t sample_size;
+    uint32_t channels;
+} Pack_Entry;
+
+typedef struct Pack Pack;
+
+// Returns NULL if the file is missing or is not a valid pack
+Pack *pack_open(const char *file_path);
+void pack_close(Pack *pack);
+// codepoints and font_size are only compared for the fonts
+const Pack_Entry *pack_find(const Pack *pack, Pack_Kind kind, const char *file_path, int font_size, const char *codepoints);
+const void *pack_at(const Pack *pack, uint64_t offset);
+// Tells whether the memory belongs to the mapping, so it must not be freed
+bool pack_contains(const Pack *pack, const void *ptr);
+
+typedef struct {
+    GlyphInfo *glyphs;  // Free with UnloadFontData()
+    Rectangle *recs;    // Where the glyphs are in the atlas, free with MemFree()
+    int glyphs_count;
+    int glyph_padding;
+    Image atlas;        // Without the mipmaps
+} Pack_Font;
+
+// Rasterizes the characters of the UTF-8 `codepoints`, or the default ones when it's NULL, into an
+// atlas. The packer bakes the fonts with it and the asset cache loads the ones that are not in the
+// pack with it, so both get the same atlas. Leaves `font` untouched when it fails.
+bool pack_rasterize_font(const char *file_path, int font_size, const char *codepoints, Pack_Font *font);
+
+#endif // PACK_H_
@@ -0,0 +1,216 @@
+// Bakes the assets listed in a manifest into an asset pack, see pack.h
+//
+// Usage: packer <manifest> <output>
+//
+// Every line of the manifest is one asset with the same path and parameters the plugins load it with:
+//
+//     font <path> <size> [<characters>]
+//     texture <path>
+//     wave <path>
+//
+// Everything after the size of a font up to the end of the line are the characters of the atlas,
+// the default ones of raylib are baked when there are none. Lines starting with # are comments.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+
+#include <raylib.h>
+
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "pack.h"
+
+// The format panim mixes and exports the sound in, see FFMPEG_SOUND_* in panim.c
+#define PACK_SOUND_SAMPLE_RATE 44100
+#define PACK_SOUND_SAMPLE_SIZE_BITS 16
+
+typedef struct {
+    Pack_Entry *items;
+    size_t count;
+    size_t capacity;
+} Pack_Entries;
+
+static void pack_align(Nob_String_Builder *pack, size_t alignment) {
+    while (pack->count%alignment != 0) nob_da_append(pack, '\0');
+}
+
+static uint64_t pack_append(Nob_String_Builder *pack, const void *data, size_t size, size_t alignment) {
+    pack_align(pack, alignment);
+    uint64_t offset = pack->count;
+    nob_sb_append_buf(pack, data, size);
+    return offset;
+}
+
+static uint64_t pack_append_cstr(Nob_String_Builder *pack, const char *cstr) {
+    return pack_append(pack, cstr, strlen(cstr) + 1, 1);
+}
+
+// The image must carry all its mipmaps
+static void pack_append_image(Nob_String_Builder *pack, Pack_Entry *entry, Image image) {
+    entry->width = image.width;
+    entry->height = image.height;
+    entry->mipmaps = image.mipmaps;
+    entry->format = image.format;
+    entry->data_size = 0;
+    int width = image.width, height = image.height;
+    for (int i = 0; i < image.mipmaps; ++i) {
+        entry->data_size += GetPixelDataSize(width, height, image.format);
+        if (width > 1) width /= 2;
+        if (height > 1) height /= 2;
+    }
+    entry->data = pack_append(pack, image.data, entry->data_size, PACK_ALIGNMENT);
+}
+
+static bool bake_font(Nob_String_Builder *pack, Pack_Entry *entry, const char *file_path, int font_size, const char *codepoints) {
+    Pack_Font font;
+    if (!pack_rasterize_font(file_path, font_size, codepoints, &font)) return false;
+    ImageMipmaps(&font.atlas);
+
+    Pack_Glyph *packed = malloc(font.glyphs_count*sizeof(*packed));
+    for (int i = 0; i < font.glyphs_count; ++i) {
+        packed[i] = (Pack_Glyph) {
+            .value = font.glyphs[i].value,
+            .offset_x = font.glyphs[i].offsetX,
+            .offset_y = font.glyphs[i].offsetY,
+            .advance_x = font.glyphs[i].advanceX,
+            .x = font.recs[i].x,
+            .y = font.recs[i].y,
+            .width = font.recs[i].width,
+            .height = font.recs[i].height,
+        };
+    }
+
+    entry->font_size = font_size;
+    entry->glyphs_count = font.glyphs_count;
+    entry->glyph_padding = font.glyph_padding;
+    entry->glyphs = pack_append(pack, packed, font.glyphs_count*sizeof(*packed), _Alignof(Pack_Glyph));
+    pack_append_image(pack, entry, font.atlas);
+
+    free(packed);
+    UnloadImage(font.atlas);
+    MemFree(font.recs);
+    UnloadFontData(font.glyphs, font.glyphs_count);
+    return true;
+}
+
+static bool bake_texture(Nob_String_Builder *pack, Pack_Entry *entry, const char *file_path) {
+    Image image = LoadImage(file_path);
+    if (image.data == NULL) return false;
+    // LoadTexture() uploads the image in the format it was decoded in, the pack keeps that
+    ImageMipmaps(&image);
+    pack_append_image(pack, entry, image);
+    UnloadImage(image);
+    return true;
+}
+
+static bool bake_wave(Nob_String_Builder *pack, Pack_Entry *entry, const char *file_path) {
+    Wave wave = LoadWave(file_path);
+    if (wave.data == NULL) return false;
+    WaveFormat(&wave, PACK_SOUND_SAMPLE_RATE, PACK_SOUND_SAMPLE_SIZE_BITS, wave.channels == 1 ? 1 : 2);
+    entry->frame_count = wave.frameCount;
+    entry->sample_rate = wave.sampleRate;
+    entry->sample_size = wave.sampleSize;
+    entry->channels = wave.channels;
+    entry->data_size = (uint64_t)wave.frameCount*wave.channels*(wave.sampleSize/8);
+    entry->data = pack_append(pack, wave.data, entry->data_size, PACK_ALIGNMENT);
+    UnloadWave(wave);
+    return true;
+}
+
+static bool bake_line(Nob_String_Builder *pack, Pack_Entries *entries, const char *manifest_path, size_t line_number, Nob_String_View line) {
+    Nob_String_View kind = nob_sv_trim(nob_sv_chop_by_delim(&line, ' '));
+    line = nob_sv_trim_left(line);
+    const char *file_path = nob_temp_sv_to_cstr(nob_sv_trim(nob_sv_chop_by_delim(&line, ' ')));
+    if (*file_path == '\0') {
+        nob_log(NOB_ERROR, "%s:%zu: no path of the asset", manifest_path, line_number);
+        return false;
+    }
+
+    struct stat statbuf;
+    if (stat(file_path, &statbuf) < 0) {
+        // The plugins fall back to the disk for whatever is not in the pack, so it's not fatal
+        nob_log(NOB_WARNING, "%s:%zu: %s does not exist, skipping it", manifest_path, line_number, file_path);
+        return true;
+    }
+
+    Pack_Entry entry = {
+        .mtime_sec = statbuf.st_mtim.tv_sec,
+        .mtime_nsec = statbuf.st_mtim.tv_nsec,
+    };
+    bool ok = false;
+    if (nob_sv_eq(kind, nob_sv_from_cstr("font"))) {
+        line = nob_sv_trim_left(line);
+        const char *size = nob_temp_sv_to_cstr(nob_sv_chop_by_delim(&line, ' '));
+        char *end = NULL;
+        long font_size = strtol(size, &end, 10);
+        if (*size == '\0' || *end != '\0' || font_size <= 0) {
+            nob_log(NOB_ERROR, "%s:%zu: invalid size of the font `%s`", manifest_path, line_number, size);
+            return false;
+        }
+        line = nob_sv_trim(line);
+        const char *codepoints = line.count > 0 ? nob_temp_sv_to_cstr(line) : NULL;
+        entry.kind = PACK_FONT;
+        entry.codepoints = codepoints ? pack_append_cstr(pack, codepoints) : 0;
+        ok = bake_font(pack, &entry, file_path, font_size, codepoints);
+    } else if (nob_sv_eq(kind, nob_sv_from_cstr("texture"))) {
+        entry.kind = PACK_TEXTURE;
+        ok = bake_texture(pack, &entry, file_path);
+    } else if (nob_sv_eq(kind, nob_sv_from_cstr("wave"))) {
+        entry.kind = PACK_WAVE;
+        ok = bake_wave(pack, &entry, file_path);
+    } else {
+        nob_log(NOB_ERROR, "%s:%zu: unknown kind of asset `"SV_Fmt"`", manifest_path, line_number, SV_Arg(kind));
+        return false;
+    }
+    if (!ok) {
+        nob_log(NOB_ERROR, "%s:%zu: could not load %s", manifest_path, line_number, file_path);
+        return false;
+    }
+
+    entry.path = pack_append_cstr(pack, file_path);
+    nob_da_append(entries, entry);
+    nob_log(NOB_INFO, "Baked %s", file_path);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *program_name = nob_shift_args(&argc, &argv);
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <manifest> <output>\n", program_name);
+        return 1;
+    }
+    const char *manifest_path = argv[0];
+    const char *output_path = argv[1];
+    SetTraceLogLevel(LOG_WARNING);
+
+    Nob_String_Builder manifest = {0};
+    if (!nob_read_entire_file(manifest_path, &manifest)) return 1;
+
+    Nob_String_Builder pack = {0};
+    Pack_Entries entries = {0};
+    Pack_Header header = {0};
+    nob_sb_append_buf(&pack, &header, sizeof(header));
+
+    Nob_String_View content = nob_sb_to_sv(manifest);
+    for (size_t line_number = 1; content.count > 0; ++line_number) {
+        Nob_String_View line = nob_sv_trim(nob_sv_chop_by_delim(&content, '\n'));
+        if (line.count == 0 || line.data[0] == '#') continue;
+        if (!bake_line(&pack, &entries, manifest_path, line_number, line)) return 1;
+        nob_temp_reset();
+    }
+
+    memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+    header.version = PACK_VERSION;
+    header.entries_count = entries.count;
+    header.entries = pack_append(&pack, entries.items, entries.count*sizeof(*entries.items), _Alignof(Pack_Entry));
+    memcpy(pack.items, &header, sizeof(header));
+
+    // panim may have the old pack mapped, so it's replaced instead of written over
+    const char *temp_path = nob_temp_sprintf("%s.tmp", output_path);
+    if (!nob_write_entire_file(temp_path, pack.items, pack.count)) return 1;
+    if (!nob_rename(temp_path, output_path)) return 1;
+    nob_log(NOB_INFO, "Baked %zu assets into %s (%.1f MiB)", entries.count, output_path, pack.count/(1024.0*1024.0));
+    return 0;
+}
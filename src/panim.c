@@ -6,40 +6,98 @@
 #include "raymath.h"
 
 #include <dlfcn.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 #define NOB_IMPLEMENTATION
 #include "nob.h"
 #include "plug.h"
 #include "ffmpeg.h"
+#include "readback.h"
+#include "yuv.h"
+#include "hash.h"
+#include "profile.h"
+#include "metrics.h"
+#include "mixer.h"
+#include "stream.h"
+#include "trace.h"
+#include "hud.h"
+#include "watch.h"
+#include "assets.h"
 
-#define FFMPEG_VIDEO_WIDTH 1920
-#define FFMPEG_VIDEO_HEIGHT 1080
-#define FFMPEG_VIDEO_FPS 60
-#define FFMPEG_VIDEO_DELTA_TIME (1.0f/FFMPEG_VIDEO_FPS)
 #define FFMPEG_SOUND_SAMPLE_RATE 44100
 #define FFMPEG_SOUND_CHANNELS 2
 #define FFMPEG_SOUND_SAMPLE_SIZE_BITS 16
 #define FFMPEG_SOUND_SAMPLE_SIZE_BYTES (FFMPEG_SOUND_SAMPLE_SIZE_BITS/8)
-// SPF - Samples Per Frame
-#define FFMPEG_SOUND_SPF (FFMPEG_SOUND_SAMPLE_RATE/FFMPEG_VIDEO_FPS)
+// The sound of a video frame is mixed and sent in blocks of this many frames
+#define FFMPEG_SOUND_BLOCK_FRAMES 1024
 #define RENDERING_FONT_SIZE 78
 #define POPUP_DISAPPER_TIME 1.5f
+// Every image sequence worker holds a couple of frames, so there is no point in more of them than cores
+#define IMAGE_SEQUENCE_MAX_THREADS 16
+// Seconds of every preview frame the uploads of the assets loaded in the background may take
+#define PREVIEW_UPLOAD_BUDGET 0.004
 
 // The state of Panim Engine
 static bool paused = false;
+static Export_Profile profile = {0};
 static FFMPEG *ffmpeg_video = NULL;
 static FFMPEG *ffmpeg_audio = NULL;
+static Readback *readback = NULL;
+static Yuv yuv = {0};
+static bool yuv_loaded = false;
+static FFMPEG_Pixel_Format video_pixel_format = FFMPEG_PIXEL_FORMAT_RGBA;
+static bool video_with_sound = false;
+// Frames that hash the same as the one before them are sent as repeats of it
+static uint64_t video_last_frame_hash = 0;
+static size_t video_frames_sent = 0;
+static size_t video_frames_repeated = 0;
+static Metrics *metrics = NULL;
+// The frame of the animation export_sound_spf() is counting the samples of
+static size_t export_sound_frame = 0;
+static const char *metrics_csv_path = NULL; // Per-frame timings of the exports, --metrics
+static const char *trace_path = NULL;       // Chrome trace of the whole run, --trace
+static const char *pack_path = "./build/assets.pack"; // Assets baked by ./nob --pack, --pack
 static RenderTexture2D screen = {0};
 static Font rendering_font = {0};
 static void *libplug = NULL;
-static Wave ffmpeg_wave = {0};
-static size_t ffmpeg_wave_cursor = 0;
-static uint8_t silence[FFMPEG_SOUND_SPF*FFMPEG_SOUND_SAMPLE_SIZE_BYTES*FFMPEG_SOUND_CHANNELS] = {0};
+// The sounds of the export and of the preview are mixed separately, so rendering in the
+// background of the preview does not cut off what it is playing
+static Mixer *ffmpeg_mixer = NULL;
+static Mixer *preview_mixer = NULL;
+static AudioStream preview_stream = {0};
+static int16_t sound_block[FFMPEG_SOUND_BLOCK_FRAMES*FFMPEG_SOUND_CHANNELS] = {0};
 
+static Hud *hud = NULL;
+// The preview rebuilds and reloads the plugin on its own whenever its sources change
+static Watch *watch = NULL;
+static int watch_src_dir = -1;
+static int watch_build_dir = -1;
+static const char *libplug_name = NULL;          // "tm" of ./build/libtm.so, what ./nob --plug takes
+static struct timespec libplug_mtime = {0};      // Of the library that is currently loaded
+static Nob_Proc rebuild_proc = NOB_INVALID_PROC;
+static bool rebuild_pending = false;
+static double rebuild_requested_at = -1.0;       // When the first unhandled change was saved
+static bool hud_visible = false;
 static float delta_time_multiplier = 1.0f;
 static float delta_time_multiplier_popup = 0.0f;
 
-static bool reload_libplug(const char *libplug_path) {
+static void replay_seek(Env env, float t);
+
+static float export_delta_time(void) {
+    return 1.0f/profile.fps;
+}
+
+// SPF - Samples Per Frame of the next frame. The frame rate does not have to divide the sample
+// rate, so every frame takes the samples up to its end counted from the start of the rendering and
+// the sound never drifts away from the video.
+static size_t export_sound_spf(void) {
+    size_t frame = export_sound_frame++;
+    return (frame + 1)*FFMPEG_SOUND_SAMPLE_RATE/profile.fps - frame*FFMPEG_SOUND_SAMPLE_RATE/profile.fps;
+}
+
+static bool load_libplug(const char *libplug_path) {
     if (libplug != NULL) {
         dlclose(libplug);
     }
@@ -59,23 +117,192 @@ static bool reload_libplug(const char *libplug_path) {
     LIST_OF_PLUGS
     #undef PLUG
 
+    #define PLUG(name, ...) \
+        name = dlsym(libplug, #name);
+    LIST_OF_OPTIONAL_PLUGS
+    #undef PLUG
+    if (plug_seek == NULL) plug_seek = replay_seek;
+    if (plug_set_assets) plug_set_assets(&asset_funcs);
+
     return true;
 }
 
-static void finish_ffmpeg_video_rendering(bool cancel) {
+static bool reload_libplug(const char *libplug_path) {
+    trace_begin("reload_libplug");
+    bool ok = load_libplug(libplug_path);
+    trace_end();
+    return ok;
+}
+
+static bool send_oldest_video_frame(void) {
+    trace_begin("readback");
+    void *pixels = readback_map(readback);
+    trace_end();
+    metrics_mark(metrics, METRICS_STAGE_READBACK);
+    if (pixels == NULL) return false;
+
+    size_t frame_size = 0;
+    switch (video_pixel_format) {
+        case FFMPEG_PIXEL_FORMAT_RGBA:    frame_size = profile.width*profile.height*4;   break;
+        case FFMPEG_PIXEL_FORMAT_YUV420P: frame_size = profile.width*profile.height*3/2; break;
+    }
+    uint64_t hash = hash_bytes(pixels, frame_size);
+    bool repeat = video_frames_sent > 0 && hash == video_last_frame_hash;
+    video_last_frame_hash = hash;
+    video_frames_sent += 1;
+    metrics_mark(metrics, METRICS_STAGE_HASH);
+
+    bool ok = false;
+    if (repeat) {
+        ok = ffmpeg_repeat_frame(ffmpeg_video);
+        video_frames_repeated += 1;
+    } else {
+        switch (video_pixel_format) {
+            case FFMPEG_PIXEL_FORMAT_RGBA:
+                ok = ffmpeg_send_frame_flipped(ffmpeg_video, pixels, profile.width, profile.height);
+                break;
+            case FFMPEG_PIXEL_FORMAT_YUV420P:
+                ok = ffmpeg_send_frame(ffmpeg_video, pixels);
+                break;
+        }
+    }
+    metrics_mark(metrics, METRICS_STAGE_SEND);
+    readback_unmap(readback);
+    metrics_mark(metrics, METRICS_STAGE_READBACK);
+    return ok;
+}
+
+static bool finish_ffmpeg_video_rendering(bool cancel) {
+    // Flush the frames that are still in flight in the readback ring
+    while (!cancel && !readback_empty(readback)) {
+        if (!send_oldest_video_frame()) cancel = true;
+    }
+    readback_destroy(readback);
+    readback = NULL;
+
     SetTraceLogLevel(LOG_INFO);
-    ffmpeg_end_rendering(ffmpeg_video, cancel);
+    bool ok = ffmpeg_end_rendering(ffmpeg_video, cancel);
+    if (ok && !cancel) {
+        metrics_print_summary(metrics, stderr);
+        nob_log(NOB_INFO, "Sent %zu of %zu frames as repeats of the frame before them", video_frames_repeated, video_frames_sent);
+    }
+    metrics_destroy(metrics);
+    metrics = NULL;
     plug_reset();
     paused = true;
     ffmpeg_video = NULL;
+    return ok && !cancel;
+}
+
+// An output path with a printf conversion like frames/%05d.qoi is an image sequence
+static bool is_image_sequence(const char *output_path) {
+    return strchr(output_path, '%') != NULL;
+}
+
+static bool image_format_from_path(const char *path, FFMPEG_Image_Format *format) {
+    Nob_String_View sv = nob_sv_from_cstr(path);
+    if (nob_sv_end_with(sv, ".qoi")) *format = FFMPEG_IMAGE_FORMAT_QOI;
+    else if (nob_sv_end_with(sv, ".png")) *format = FFMPEG_IMAGE_FORMAT_PNG;
+    else if (nob_sv_end_with(sv, ".raw") || nob_sv_end_with(sv, ".rgba")) *format = FFMPEG_IMAGE_FORMAT_RAW;
+    else return false;
+    return true;
+}
+
+static FFMPEG *start_rendering_images(const char *path_pattern, size_t first_frame) {
+    FFMPEG_Image_Format format;
+    if (!image_format_from_path(path_pattern, &format)) {
+        TraceLog(LOG_ERROR, "Unknown image format of %s, expected .qoi, .png or .raw", path_pattern);
+        return NULL;
+    }
+
+    const char *dir_end = strrchr(path_pattern, '/');
+    if (dir_end != NULL && !nob_mkdir_if_not_exists(nob_temp_sprintf("%.*s", (int)(dir_end - path_pattern), path_pattern))) {
+        return NULL;
+    }
+
+    // One core keeps rendering, the rest encode
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = cores > 1 ? cores - 1 : 1;
+    if (threads > IMAGE_SEQUENCE_MAX_THREADS) threads = IMAGE_SEQUENCE_MAX_THREADS;
+    return ffmpeg_start_rendering_images(path_pattern, (FFMPEG_Image_Params) {
+        .width = profile.width,
+        .height = profile.height,
+        .format = format,
+        .threads = threads,
+        .first_frame = first_frame,
+    });
+}
+
+static FFMPEG *start_rendering_video(const char *output_path, bool with_sound) {
+    return ffmpeg_start_rendering_video_ex(output_path, (FFMPEG_Video_Params) {
+        .width = profile.width,
+        .height = profile.height,
+        .fps = profile.fps,
+        .codec = profile.codec,
+        .preset = profile.preset,
+        .crf = profile.crf,
+        .bitrate = profile.bitrate,
+        .pixel_format = video_pixel_format,
+        .sound_sample_rate = with_sound ? FFMPEG_SOUND_SAMPLE_RATE : 0,
+        .sound_channels = with_sound ? FFMPEG_SOUND_CHANNELS : 0,
+        .log_path = nob_temp_sprintf("%s.log", output_path),
+    });
+}
+
+// frames_total is only used to estimate the remaining time, 0 when it's unknown. first_frame
+// numbers the files of an image sequence.
+static void start_ffmpeg_video_rendering(const char *output_path, bool with_sound, size_t frames_total, size_t first_frame) {
+    SetTraceLogLevel(LOG_WARNING);
+    if (is_image_sequence(output_path)) {
+        if (with_sound) {
+            TraceLog(LOG_WARNING, "Image sequences have no sound, render it into a .wav separately");
+            with_sound = false;
+        }
+        video_pixel_format = FFMPEG_PIXEL_FORMAT_RGBA;
+        ffmpeg_video = start_rendering_images(output_path, first_frame);
+    } else {
+        // Convert to I420 on the GPU when possible so only 1.5 bytes per pixel are read back and piped
+        video_pixel_format = yuv_loaded ? FFMPEG_PIXEL_FORMAT_YUV420P : FFMPEG_PIXEL_FORMAT_RGBA;
+        ffmpeg_video = start_rendering_video(output_path, with_sound);
+    }
+    if (ffmpeg_video == NULL) return;
+    metrics = metrics_create(metrics_csv_path, frames_total);
+    video_with_sound = with_sound;
+
+    mixer_stop_all(ffmpeg_mixer);
+    export_sound_frame = 0;
+    video_frames_sent = 0;
+    video_frames_repeated = 0;
+
+    switch (video_pixel_format) {
+        case FFMPEG_PIXEL_FORMAT_RGBA:
+            readback = readback_create(screen.texture.width, screen.texture.height);
+            break;
+        case FFMPEG_PIXEL_FORMAT_YUV420P:
+            readback = readback_create(yuv.target.texture.width, yuv.target.texture.height);
+            break;
+    }
 }
 
-static void finish_ffmpeg_audio_rendering(bool cancel) {
+static void start_ffmpeg_audio_rendering(const char *output_path, size_t frames_total) {
+    SetTraceLogLevel(LOG_WARNING);
+    ffmpeg_audio = ffmpeg_start_rendering_audio(output_path, nob_temp_sprintf("%s.log", output_path));
+    if (ffmpeg_audio == NULL) return;
+    metrics = metrics_create(metrics_csv_path, frames_total);
+    mixer_stop_all(ffmpeg_mixer);
+    export_sound_frame = 0;
+}
+
+static bool finish_ffmpeg_audio_rendering(bool cancel) {
     SetTraceLogLevel(LOG_INFO);
-    ffmpeg_end_rendering(ffmpeg_audio, cancel);
+    bool ok = ffmpeg_end_rendering(ffmpeg_audio, cancel);
+    if (ok && !cancel) metrics_print_summary(metrics, stderr);
+    metrics_destroy(metrics);
+    metrics = NULL;
     plug_reset();
     paused = true;
     ffmpeg_audio = NULL;
+    return ok && !cancel;
 }
 
 void dummy_play_sound(Sound _sound, Wave _wave) {
@@ -83,28 +310,568 @@ void dummy_play_sound(Sound _sound, Wave _wave) {
     (void)_wave;
 }
 
+void dummy_play_wave(Wave _wave, float _gain, float _pan) {
+    (void)_wave;
+    (void)_gain;
+    (void)_pan;
+}
+
+// The mixer only takes the sample rate and the sample size of the export, anything else is
+// converted once the first time it is played and kept for as long as the plugin is loaded
+typedef struct {
+    Wave source; // Only used as the key, the plugin owns the samples
+    Wave converted;
+} Converted_Wave;
+
+static struct {
+    Converted_Wave *items;
+    size_t count;
+    size_t capacity;
+} converted_waves = {0};
+
+static bool wave_is_mixable(Wave wave) {
+    return wave.sampleRate == FFMPEG_SOUND_SAMPLE_RATE
+        && wave.sampleSize == FFMPEG_SOUND_SAMPLE_SIZE_BITS
+        && (wave.channels == 1 || wave.channels == 2);
+}
+
+static Wave convert_wave(Wave wave) {
+    for (size_t i = 0; i < converted_waves.count; ++i) {
+        Wave source = converted_waves.items[i].source;
+        if (source.data == wave.data && source.frameCount == wave.frameCount &&
+            source.sampleRate == wave.sampleRate && source.sampleSize == wave.sampleSize &&
+            source.channels == wave.channels) {
+            return converted_waves.items[i].converted;
+        }
+    }
+
+    Wave converted = WaveCopy(wave);
+    WaveFormat(&converted, FFMPEG_SOUND_SAMPLE_RATE, FFMPEG_SOUND_SAMPLE_SIZE_BITS, wave.channels == 1 ? 1 : FFMPEG_SOUND_CHANNELS);
+    TraceLog(LOG_INFO, "Converted sound from %dhz, %d bits, %d channels for mixing",
+             wave.sampleRate, wave.sampleSize, wave.channels);
+    Converted_Wave item = { .source = wave, .converted = converted };
+    nob_da_append(&converted_waves, item);
+    return converted;
+}
+
+// The mixers may still be playing the converted waves, stop them first
+static void unload_converted_waves(void) {
+    for (size_t i = 0; i < converted_waves.count; ++i) {
+        UnloadWave(converted_waves.items[i].converted);
+    }
+    converted_waves.count = 0;
+}
+
+static bool mix_wave(Mixer *mixer, Wave wave, float gain, float pan) {
+    if (wave.data == NULL || wave.frameCount == 0) return false;
+    if (!wave_is_mixable(wave)) {
+        wave = convert_wave(wave);
+        if (!wave_is_mixable(wave)) return false;
+    }
+    return mixer_play(mixer, wave.data, wave.frameCount, wave.channels, gain, pan);
+}
+
+void dummy_play_stream(const char *_file_path, float _gain, float _pan) {
+    (void)_file_path;
+    (void)_gain;
+    (void)_pan;
+}
+
+static bool mix_stream(Mixer *mixer, const char *file_path, float gain, float pan) {
+    Sound_Stream *stream = sound_stream_open(file_path);
+    if (stream == NULL) return false;
+    if (sound_stream_sample_rate(stream) != FFMPEG_SOUND_SAMPLE_RATE) {
+        TraceLog(LOG_ERROR, "Animation tried to stream %s with rate: %zuhz. But we only stream %dhz for now, play it as a wave instead",
+                 file_path, sound_stream_sample_rate(stream), FFMPEG_SOUND_SAMPLE_RATE);
+        sound_stream_close(stream);
+        return false;
+    }
+    return mixer_play_stream(mixer, stream, gain, pan);
+}
+
 void ffmpeg_play_sound(Sound _sound, Wave wave) {
     (void)_sound;
+    mix_wave(ffmpeg_mixer, wave, 1.0f, 0.0f);
+}
+
+void ffmpeg_play_wave(Wave wave, float gain, float pan) {
+    mix_wave(ffmpeg_mixer, wave, gain, pan);
+}
+
+void ffmpeg_play_stream(const char *file_path, float gain, float pan) {
+    mix_stream(ffmpeg_mixer, file_path, gain, pan);
+}
+
+// Sends one video frame worth of the sounds that are playing
+static bool send_sound_frame(FFMPEG *ffmpeg) {
+    size_t frame_size = FFMPEG_SOUND_SAMPLE_SIZE_BYTES*FFMPEG_SOUND_CHANNELS;
+    size_t frames = export_sound_spf();
+    while (frames > 0) {
+        size_t n = frames < FFMPEG_SOUND_BLOCK_FRAMES ? frames : FFMPEG_SOUND_BLOCK_FRAMES;
+        mixer_update(ffmpeg_mixer);
+        mixer_mix(ffmpeg_mixer, sound_block, n);
+        if (!ffmpeg_send_sound_samples(ffmpeg, sound_block, n*frame_size)) return false;
+        frames -= n;
+    }
+    return true;
+}
+
+static bool render_video_frame(void) {
+    metrics_frame_begin(metrics);
+    assets_wait();
+    BeginTextureMode(screen);
+    trace_begin("plug_update");
+    plug_update(CLITERAL(Env) {
+        .screen_width = profile.width,
+        .screen_height = profile.height,
+        .delta_time = export_delta_time(),
+        .rendering = true,
+        .play_sound = video_with_sound ? ffmpeg_play_sound : dummy_play_sound,
+        .play_wave = video_with_sound ? ffmpeg_play_wave : dummy_play_wave,
+        .play_stream = video_with_sound ? ffmpeg_play_stream : dummy_play_stream,
+        .trace = &trace_funcs,
+    });
+    trace_end();
+    EndTextureMode();
+    metrics_mark(metrics, METRICS_STAGE_UPDATE);
+
+    // The sound goes straight into its own pipe and stays ahead of the frames in the readback ring
+    if (video_with_sound && !send_sound_frame(ffmpeg_video)) return false;
+    metrics_mark(metrics, METRICS_STAGE_SOUND);
+
+    RenderTexture2D frame = screen;
+    if (video_pixel_format == FFMPEG_PIXEL_FORMAT_YUV420P) {
+        yuv_convert(&yuv, screen.texture);
+        frame = yuv.target;
+    }
+    metrics_mark(metrics, METRICS_STAGE_CONVERT);
+
+    if (readback_full(readback) && !send_oldest_video_frame()) return false;
+    readback_push(readback, frame);
+    metrics_mark(metrics, METRICS_STAGE_READBACK);
+    metrics_frame_end(metrics);
+    return true;
+}
+
+static void simulate_frame(Env env);
+
+// The sound does not depend on the picture, so the animation is only simulated
+static bool render_audio_frame(void) {
+    metrics_frame_begin(metrics);
+    simulate_frame(CLITERAL(Env) {
+        .screen_width = profile.width,
+        .screen_height = profile.height,
+        .delta_time = export_delta_time(),
+        .rendering = true,
+        .play_sound = ffmpeg_play_sound,
+        .play_wave = ffmpeg_play_wave,
+        .play_stream = ffmpeg_play_stream,
+        .trace = &trace_funcs,
+    });
+    metrics_mark(metrics, METRICS_STAGE_UPDATE);
+
+    bool ok = send_sound_frame(ffmpeg_audio);
+    metrics_mark(metrics, METRICS_STAGE_SOUND);
+    metrics_frame_end(metrics);
+    return ok;
+}
+
+static Env seek_env(bool with_sound) {
+    return CLITERAL(Env) {
+        .screen_width = profile.width,
+        .screen_height = profile.height,
+        .delta_time = export_delta_time(),
+        .rendering = true,
+        .play_sound = with_sound ? ffmpeg_play_sound : dummy_play_sound,
+        .play_wave = with_sound ? ffmpeg_play_wave : dummy_play_wave,
+        .play_stream = with_sound ? ffmpeg_play_stream : dummy_play_stream,
+        .trace = &trace_funcs,
+    };
+}
+
+// Advances the animation by one frame without drawing it. The plugins that don't check
+// Env.no_draw still draw, but all of it is clipped away by the scissor.
+static void simulate_frame(Env env) {
+    // The sounds must be there even if nothing is drawn
+    assets_wait();
+    env.no_draw = true;
+    BeginScissorMode(0, 0, 0, 0);
+    trace_begin("plug_update");
+    plug_update(env);
+    trace_end();
+    EndScissorMode();
+}
+
+static void replay_frame(Env env) {
+    simulate_frame(env);
+    trace_flush();
+
+    // Keep the sound that started before the skipped frames playing from the right spot
+    if (env.play_sound == ffmpeg_play_sound) {
+        mixer_skip(ffmpeg_mixer, export_sound_spf());
+        mixer_update(ffmpeg_mixer);
+    }
+}
+
+// The default plug_seek for the plugins that don't implement it
+static void replay_seek(Env env, float t) {
+    plug_reset();
+    export_sound_frame = 0;
+    size_t frames = roundf(t/env.delta_time);
+    for (size_t i = 0; i < frames && !plug_finished(); ++i) {
+        replay_frame(env);
+    }
+}
+
+// The tasks don't know their duration upfront, so the only way to learn the length of the
+// animation is to play it once without drawing it. Stops counting at `limit` frames.
+static size_t count_frames(size_t limit) {
+    plug_reset();
+    size_t frames = 0;
+    for (; frames < limit && !plug_finished(); ++frames) {
+        replay_frame(seek_env(false));
+    }
+    return frames;
+}
+
+// Renders the frames [frames_begin, frames_end) of the animation into output_path as fast as
+// possible without the preview. A .wav output renders only the sound. With `progress` the
+// animation is counted upfront and the progress is reported on stderr every second.
+static bool render_headless(const char *output_path, bool with_sound, size_t frames_begin, size_t frames_end, bool progress) {
+    bool audio_only = nob_sv_end_with(nob_sv_from_cstr(output_path), ".wav");
+
+    size_t frames_total = 0;
+    if (progress) {
+        size_t frames_count = count_frames(frames_end);
+        frames_total = frames_count > frames_begin ? frames_count - frames_begin : 0;
+    }
+
+    if (audio_only) {
+        start_ffmpeg_audio_rendering(output_path, frames_total);
+        if (ffmpeg_audio == NULL) return false;
+    } else {
+        start_ffmpeg_video_rendering(output_path, with_sound, frames_total, frames_begin);
+        if (ffmpeg_video == NULL) return false;
+    }
+
+    // The sound that is still playing at the beginning of the range is known only to the host,
+    // so the plugin seeks on its own only when there is no sound to carry over
+    if (frames_begin > 0) {
+        bool track_sound = with_sound || audio_only;
+        void (*seek)(Env, float) = track_sound ? replay_seek : plug_seek;
+        seek(seek_env(track_sound), frames_begin*export_delta_time());
+    } else {
+        plug_reset();
+    }
+
+    bool overwrite = isatty(STDERR_FILENO);
+    double last_progress = GetTime();
+    for (size_t frame = frames_begin; frame < frames_end && !plug_finished(); ++frame) {
+        trace_flush();
+        if (audio_only) {
+            if (!render_audio_frame()) return finish_ffmpeg_audio_rendering(true);
+        } else {
+            if (!render_video_frame()) return finish_ffmpeg_video_rendering(true);
+        }
+
+        if (progress && GetTime() - last_progress >= 1.0) {
+            metrics_print_progress(metrics, stderr, overwrite);
+            last_progress = GetTime();
+        }
+    }
+    if (progress) {
+        metrics_print_progress(metrics, stderr, overwrite);
+        if (overwrite) fprintf(stderr, "\n");
+    }
+
+    if (audio_only) {
+        if (!finish_ffmpeg_audio_rendering(false)) return false;
+    } else {
+        if (!finish_ffmpeg_video_rendering(false)) return false;
+    }
+    return true;
+}
+
+// Splits the frames [frames_begin, frames_end) of the animation into `jobs` ranges, renders each
+// range in its own headless panim process and joins the segments with the concat demuxer of ffmpeg
+// without re-encoding.
+// The segments are rendered without sound. The sound of the whole range is rendered once into a .wav by
+// one more process and muxed over the joined video, so there are no gaps or drift at the joins.
+// The segments are rendered with the same export profile, `profile_flags` are the flags that selected it.
+static bool render_parallel(const char *libplug_path, const char *output_path, bool with_sound, size_t jobs, size_t frames_begin, size_t frames_end, Nob_Cmd profile_flags) {
+    double start = GetTime();
+
+    frames_end = count_frames(frames_end);
+    if (frames_begin >= frames_end) {
+        nob_log(NOB_ERROR, "There are no frames to render in the range");
+        return false;
+    }
+    size_t frames_count = frames_end - frames_begin;
+    if (jobs > frames_count) jobs = frames_count;
+    size_t frames_per_job = (frames_count + jobs - 1)/jobs;
+    nob_log(NOB_INFO, "Rendering %zu frames in %zu segments of %zu frames", frames_count, jobs, frames_per_job);
+
+    const char *ext = strrchr(output_path, '.');
+    if (ext == NULL || strchr(ext, '/') != NULL) ext = "";
+    const char *list_path = nob_temp_sprintf("%s.segments.txt", output_path);
+    const char *sound_path = nob_temp_sprintf("%s.sound.wav", output_path);
+    const char *output_dir_end = strrchr(output_path, '/');
+
+    // The files of an image sequence are numbered by the frame, so the segments don't need joining
+    bool image_sequence = is_image_sequence(output_path);
+    if (image_sequence) with_sound = false;
+
+    bool ok = true;
+    Nob_Cmd cmd = {0};
+    Nob_Procs procs = {0};
+    Nob_String_Builder list = {0};
+    Nob_File_Paths segment_paths = {0};
+    for (size_t i = 0; i < jobs; ++i) {
+        size_t begin = frames_begin + i*frames_per_job;
+        size_t end = begin + frames_per_job;
+        if (end > frames_end) end = frames_end;
+        if (begin >= end) break;
+
+        const char *segment_path = image_sequence ? output_path : nob_temp_sprintf("%.*s.segment-%02zu%s", (int)(strlen(output_path) - strlen(ext)), output_path, i, ext);
+        if (!image_sequence) nob_da_append(&segment_paths, segment_path);
+        // The paths in the list are relative to the list itself, which sits next to the segments
+        const char *segment_name = output_dir_end ? segment_path + (output_dir_end - output_path) + 1 : segment_path;
+        nob_sb_append_cstr(&list, nob_temp_sprintf("file '%s'\n", segment_name));
+
+        cmd.count = 0;
+        nob_cmd_append(&cmd, "/proc/self/exe", "--render", segment_path);
+        if (metrics_csv_path) nob_cmd_append(&cmd, "--metrics", nob_temp_sprintf("%s.segment-%02zu.csv", metrics_csv_path, i));
+        if (trace_path) nob_cmd_append(&cmd, "--trace", nob_temp_sprintf("%s.segment-%02zu.json", trace_path, i));
+        nob_cmd_append(&cmd, "--pack", pack_path);
+        nob_cmd_append(&cmd, "--quiet");
+        nob_da_append_many(&cmd, profile_flags.items, profile_flags.count);
+        nob_cmd_append(&cmd, "--frames", nob_temp_sprintf("%zu", begin), nob_temp_sprintf("%zu", end));
+        nob_cmd_append(&cmd, libplug_path);
+        nob_da_append(&procs, nob_cmd_run_async(cmd));
+    }
+    if (with_sound) {
+        cmd.count = 0;
+        nob_cmd_append(&cmd, "/proc/self/exe", "--render", sound_path);
+        nob_cmd_append(&cmd, "--pack", pack_path);
+        nob_cmd_append(&cmd, "--quiet");
+        nob_da_append_many(&cmd, profile_flags.items, profile_flags.count);
+        nob_cmd_append(&cmd, "--frames", nob_temp_sprintf("%zu", frames_begin), nob_temp_sprintf("%zu", frames_end));
+        nob_cmd_append(&cmd, libplug_path);
+        nob_da_append(&procs, nob_cmd_run_async(cmd));
+    }
+    if (!nob_procs_wait(procs)) {
+        nob_log(NOB_ERROR, "Some of the segments failed to render");
+        ok = false;
+        goto defer;
+    }
+    if (!image_sequence) {
+        if (!nob_write_entire_file(list_path, list.items, list.count)) {
+            ok = false;
+            goto defer;
+        }
+        cmd.count = 0;
+        nob_cmd_append(&cmd, "ffmpeg", "-loglevel", "error", "-y", "-f", "concat", "-safe", "0", "-i", list_path);
+        if (with_sound) {
+            nob_cmd_append(&cmd,
+                "-i", sound_path,
+                "-map", "0:v", "-map", "1:a",
+                "-c:v", "copy",
+                "-c:a", "aac",
+                "-ab", "200k");
+        } else {
+            nob_cmd_append(&cmd, "-c", "copy");
+        }
+        nob_cmd_append(&cmd, output_path);
+        if (!nob_cmd_run_sync(cmd)) {
+            ok = false;
+            goto defer;
+        }
+    }
+
+    double elapsed = GetTime() - start;
+    nob_log(NOB_INFO, "Rendered %zu frames into %s in %.2fs (%.2f fps)", frames_count, output_path, elapsed, frames_count/elapsed);
+
+defer:
+    // The segments of a failed rendering are of no use either, only the logs of --metrics and --trace stay
+    for (size_t i = 0; i < segment_paths.count; ++i) remove(segment_paths.items[i]);
+    if (!image_sequence) remove(list_path);
+    if (with_sound) remove(sound_path);
+    nob_cmd_free(cmd);
+    nob_da_free(procs);
+    nob_sb_free(list);
+    nob_da_free(segment_paths);
+    return ok;
+}
+
+// The targets every export renders into, they live as long as the window
+static void unload_export_targets(void) {
+    if (yuv_loaded) yuv_unload(&yuv);
+    yuv_loaded = false;
+    UnloadRenderTexture(screen);
+}
+
+static void usage(const char *program_name) {
+    fprintf(stderr, "Usage: %s [OPTIONS] <libplug.so>\n", program_name);
+    fprintf(stderr, "OPTIONS:\n");
+    fprintf(stderr, "    --render <output>    Render the animation into the output without opening the preview and exit.\n");
+    fprintf(stderr, "                         An output ending with .wav renders only the sound. An output with the\n");
+    fprintf(stderr, "                         frame number like frames/%%05d.qoi renders a sequence of .qoi, .png or .raw images\n");
+    fprintf(stderr, "    --audio              Mux the sound into the rendered video\n");
+    fprintf(stderr, "    --jobs <count>       Render the video in <count> segments by parallel processes and join them\n");
+    fprintf(stderr, "    --from <seconds>     Start rendering at this time of the animation\n");
+    fprintf(stderr, "    --to <seconds>       Stop rendering at this time of the animation\n");
+    fprintf(stderr, "    --frames <begin> <end>\n");
+    fprintf(stderr, "                         Render only the frames [begin, end) of the animation\n");
+    fprintf(stderr, "    --profile <name>     Export with one of the profiles (default: %s):\n", DEFAULT_EXPORT_PROFILE);
+    profile_print_names();
+    fprintf(stderr, "    --config <path>      Override the export profile with the key = value lines of the file\n");
+    fprintf(stderr, "    --metrics <path>     Write the time every export stage took for every frame into a CSV file\n");
+    fprintf(stderr, "    --trace <path>       Record a Chrome trace of the run, open it in chrome://tracing or ui.perfetto.dev\n");
+    fprintf(stderr, "    --pack <path>        Take the assets from the pack baked by ./nob --pack (default: %s)\n", pack_path);
+    fprintf(stderr, "    --quiet              Don't report the progress of the rendering\n");
+    fprintf(stderr, "The output of ffmpeg goes into <output>.log\n");
+}
+
+static bool parse_seconds(const char *program_name, const char *flag, const char *arg, float *seconds) {
+    char *endptr = NULL;
+    *seconds = strtof(arg, &endptr);
+    if (endptr == arg || *endptr != '\0' || !(*seconds >= 0.0f)) {
+        usage(program_name);
+        fprintf(stderr, "ERROR: %s expects a non-negative amount of seconds, but got %s\n", flag, arg);
+        return false;
+    }
+    return true;
+}
+
+static bool parse_size(const char *program_name, const char *flag, const char *arg, size_t *size) {
+    char *endptr = NULL;
+    unsigned long long value = strtoull(arg, &endptr, 10);
+    if (endptr == arg || *endptr != '\0') {
+        usage(program_name);
+        fprintf(stderr, "ERROR: %s expects a non-negative integer, but got %s\n", flag, arg);
+        return false;
+    }
+    *size = value;
+    return true;
+}
+
+void preview_play_sound(Sound _sound, Wave wave) {
+    (void)_sound;
+    mix_wave(preview_mixer, wave, 1.0f, 0.0f);
+}
+
+void preview_play_wave(Wave wave, float gain, float pan) {
+    mix_wave(preview_mixer, wave, gain, pan);
+}
+
+void preview_play_stream(const char *file_path, float gain, float pan) {
+    mix_stream(preview_mixer, file_path, gain, pan);
+}
+
+// Called by raylib on its audio thread whenever the preview stream needs more sound
+static void preview_stream_callback(void *buffer, unsigned int frames) {
+    mixer_mix(preview_mixer, buffer, frames);
+}
+
+static const char *path_base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static struct timespec file_mtime(const char *file_path) {
+    struct stat statbuf = {0};
+    stat(file_path, &statbuf);
+    return statbuf.st_mtim;
+}
 
-    if (
-        wave.sampleRate != FFMPEG_SOUND_SAMPLE_RATE      ||
-        wave.sampleSize != FFMPEG_SOUND_SAMPLE_SIZE_BITS ||
-        wave.channels   != FFMPEG_SOUND_CHANNELS
-    ) {
-        TraceLog(LOG_ERROR,
-                 "Animation tried to play sound with rate: %dhz, sample size: %d bits, channels: %d. "
-                 "But we only support rate: %dhz, sample size: %d bits, channels: %d for now",
-                 wave.sampleRate, wave.sampleSize, wave.channels);
+static void hot_reload(const char *libplug_path) {
+    mixer_stop_all(preview_mixer);
+    unload_converted_waves();
+    void *state = plug_pre_reload();
+    reload_libplug(libplug_path);
+    plug_post_reload(state);
+    // Whatever the new version did not load again is not needed anymore
+    assets_collect();
+    libplug_mtime = file_mtime(libplug_path);
+}
+
+// Both our own rebuilds and the ones started by hand end up here, the library is only
+// reloaded when it actually changed since the last time
+static void hot_reload_if_changed(const char *libplug_path) {
+    struct timespec mtime = file_mtime(libplug_path);
+    if (mtime.tv_sec == libplug_mtime.tv_sec && mtime.tv_nsec == libplug_mtime.tv_nsec) return;
+    hot_reload(libplug_path);
+    if (rebuild_requested_at >= 0.0) {
+        nob_log(NOB_INFO, "Reloaded %s %.0fms after the change", libplug_path, (GetTime() - rebuild_requested_at)*1000.0);
+        rebuild_requested_at = -1.0;
+    } else {
+        nob_log(NOB_INFO, "Reloaded %s", libplug_path);
+    }
+}
+
+static void start_auto_reload(const char *libplug_path) {
+    libplug_mtime = file_mtime(libplug_path);
+
+    // ./build/libtm.so -> tm
+    Nob_String_View name = nob_sv_from_cstr(path_base_name(libplug_path));
+    if (strncmp(name.data, "lib", 3) != 0 || !nob_sv_end_with(name, ".so") || name.count <= 6) {
+        nob_log(NOB_WARNING, "%s is not named like the plugins of ./nob, it will not be rebuilt on changes", libplug_path);
+        return;
+    }
+    name.data += 3;
+    name.count -= 3 + 3;
+    libplug_name = nob_temp_sv_to_cstr(name);
+    if (access("./nob", X_OK) != 0) {
+        nob_log(NOB_WARNING, "./nob is not found, %s will not be rebuilt on changes", libplug_path);
         return;
     }
 
-    ffmpeg_wave = wave;
-    ffmpeg_wave_cursor = 0;
+    watch = watch_create();
+    if (watch == NULL) return;
+    watch_src_dir = watch_dir(watch, "./src");
+    const char *build_dir = nob_temp_sprintf("%.*s", (int)(path_base_name(libplug_path) - libplug_path), libplug_path);
+    watch_build_dir = watch_dir(watch, *build_dir ? build_dir : ".");
+    nob_log(NOB_INFO, "Watching ./src, %s is rebuilt and reloaded on changes", libplug_path);
 }
 
-void preview_play_sound(Sound sound, Wave _wave) {
-    (void)_wave;
-    PlaySound(sound);
+// Polls the changes and the rebuild without ever blocking the preview
+static void update_auto_reload(const char *libplug_path) {
+    if (watch == NULL) return;
+
+    int dir = -1;
+    const char *file_name = NULL;
+    while (watch_next(watch, &dir, &file_name)) {
+        Nob_String_View name = nob_sv_from_cstr(file_name);
+        if (dir == watch_src_dir && (nob_sv_end_with(name, ".c") || nob_sv_end_with(name, ".h") || nob_sv_end_with(name, ".cpp"))) {
+            if (rebuild_requested_at < 0.0) rebuild_requested_at = GetTime();
+            rebuild_pending = true;
+        } else if (dir == watch_build_dir && strcmp(file_name, path_base_name(libplug_path)) == 0) {
+            // Rebuilt by hand. Our own rebuild is picked up once it finishes.
+            if (rebuild_proc == NOB_INVALID_PROC) hot_reload_if_changed(libplug_path);
+        }
+    }
+
+    if (rebuild_proc != NOB_INVALID_PROC) {
+        int wstatus = 0;
+        pid_t pid = waitpid(rebuild_proc, &wstatus, WNOHANG);
+        if (pid == 0) return;
+        rebuild_proc = NOB_INVALID_PROC;
+        if (pid > 0 && WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0) {
+            hot_reload_if_changed(libplug_path);
+        } else {
+            nob_log(NOB_ERROR, "Could not rebuild %s, keeping the old one", libplug_path);
+            rebuild_requested_at = -1.0;
+        }
+    }
+
+    // The changes saved during a rebuild get a rebuild of their own
+    if (rebuild_pending) {
+        rebuild_pending = false;
+        Nob_Cmd cmd = {0};
+        nob_cmd_append(&cmd, "./nob", "--plug", libplug_name);
+        rebuild_proc = nob_cmd_run_async(cmd);
+        nob_cmd_free(cmd);
+    }
 }
 
 void rendering_scene(const char *text) {
@@ -152,28 +919,182 @@ void rendering_scene(const char *text) {
 int main(int argc, char **argv) {
     const char *program_name = nob_shift_args(&argc, &argv);
 
-    if (argc <= 0) {
-        fprintf(stderr, "Usage: %s <libplug.so>\n", program_name);
+    const char *libplug_path = NULL;
+    const char *render_path = NULL;
+    bool render_with_sound = false;
+    bool render_progress = true;
+    size_t render_jobs = 1;
+    size_t render_frames_begin = 0;
+    size_t render_frames_end = SIZE_MAX;
+    float render_from = -1.0f;
+    float render_to = -1.0f;
+    Nob_Cmd profile_flags = {0};
+    if (!profile_find(DEFAULT_EXPORT_PROFILE, &profile)) assert(0 && "Unreachable");
+    while (argc > 0) {
+        const char *arg = nob_shift_args(&argc, &argv);
+        if (strcmp(arg, "--render") == 0) {
+            if (argc <= 0) {
+                usage(program_name);
+                fprintf(stderr, "ERROR: no output is provided for %s\n", arg);
+                return 1;
+            }
+            render_path = nob_shift_args(&argc, &argv);
+        } else if (strcmp(arg, "--audio") == 0) {
+            render_with_sound = true;
+        } else if (strcmp(arg, "--jobs") == 0) {
+            if (argc <= 0) {
+                usage(program_name);
+                fprintf(stderr, "ERROR: no count is provided for %s\n", arg);
+                return 1;
+            }
+            if (!parse_size(program_name, arg, nob_shift_args(&argc, &argv), &render_jobs)) return 1;
+            if (render_jobs == 0) render_jobs = 1;
+        } else if (strcmp(arg, "--from") == 0 || strcmp(arg, "--to") == 0) {
+            if (argc <= 0) {
+                usage(program_name);
+                fprintf(stderr, "ERROR: no time is provided for %s\n", arg);
+                return 1;
+            }
+            float *seconds = strcmp(arg, "--from") == 0 ? &render_from : &render_to;
+            if (!parse_seconds(program_name, arg, nob_shift_args(&argc, &argv), seconds)) return 1;
+        } else if (strcmp(arg, "--frames") == 0) {
+            if (argc <= 1) {
+                usage(program_name);
+                fprintf(stderr, "ERROR: %s expects the beginning and the end of the range\n", arg);
+                return 1;
+            }
+            if (!parse_size(program_name, arg, nob_shift_args(&argc, &argv), &render_frames_begin)) return 1;
+            if (!parse_size(program_name, arg, nob_shift_args(&argc, &argv), &render_frames_end)) return 1;
+        } else if (strcmp(arg, "--profile") == 0) {
+            if (argc <= 0) {
+                usage(program_name);
+                fprintf(stderr, "ERROR: no profile name is provided for %s\n", arg);
+                return 1;
+            }
+            const char *name = nob_shift_args(&argc, &argv);
+            if (!profile_find(name, &profile)) {
+                usage(program_name);
+                fprintf(stderr, "ERROR: unknown export profile %s\n", name);
+                return 1;
+            }
+            nob_cmd_append(&profile_flags, arg, name);
+        } else if (strcmp(arg, "--config") == 0) {
+            if (argc <= 0) {
+                usage(program_name);
+                fprintf(stderr, "ERROR: no config file is provided for %s\n", arg);
+                return 1;
+            }
+            const char *path = nob_shift_args(&argc, &argv);
+            if (!profile_load_config(path, &profile)) return 1;
+            nob_cmd_append(&profile_flags, arg, path);
+        } else if (strcmp(arg, "--metrics") == 0) {
+            if (argc <= 0) {
+                usage(program_name);
+                fprintf(stderr, "ERROR: no path is provided for %s\n", arg);
+                return 1;
+            }
+            metrics_csv_path = nob_shift_args(&argc, &argv);
+        } else if (strcmp(arg, "--trace") == 0) {
+            if (argc <= 0) {
+                usage(program_name);
+                fprintf(stderr, "ERROR: no path is provided for %s\n", arg);
+                return 1;
+            }
+            trace_path = nob_shift_args(&argc, &argv);
+        } else if (strcmp(arg, "--pack") == 0) {
+            if (argc <= 0) {
+                usage(program_name);
+                fprintf(stderr, "ERROR: no path is provided for %s\n", arg);
+                return 1;
+            }
+            pack_path = nob_shift_args(&argc, &argv);
+        } else if (strcmp(arg, "--quiet") == 0) {
+            render_progress = false;
+        } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            usage(program_name);
+            return 0;
+        } else if (strncmp(arg, "--", 2) == 0) {
+            usage(program_name);
+            fprintf(stderr, "ERROR: unknown flag %s\n", arg);
+            return 1;
+        } else if (libplug_path == NULL) {
+            libplug_path = arg;
+        } else {
+            usage(program_name);
+            fprintf(stderr, "ERROR: unexpected argument %s\n", arg);
+            return 1;
+        }
+    }
+
+    if (libplug_path == NULL) {
+        usage(program_name);
         fprintf(stderr, "ERROR: no animation dynamic library is provided\n");
         return 1;
     }
 
-    const char *libplug_path = nob_shift_args(&argc, &argv);
+    if (!profile_valid(&profile)) return 1;
+    // The time range depends on the fps of the profile, which may come after it
+    if (render_from >= 0.0f) render_frames_begin = roundf(render_from*profile.fps);
+    if (render_to >= 0.0f) render_frames_end = roundf(render_to*profile.fps);
 
+    if (trace_path) {
+        if (!trace_start(trace_path)) return 1;
+        trace_thread_name("main");
+    }
+    // Without the pack the assets are simply decoded from their files
+    assets_open_pack(pack_path);
     if (!reload_libplug(libplug_path)) return 1;
 
     float scale_factor = 100.0f;
-    SetConfigFlags(FLAG_MSAA_4X_HINT | FLAG_WINDOW_RESIZABLE);
+    if (render_path) {
+        // The window only provides the OpenGL context. There is no frame limiter since
+        // BeginDrawing()/EndDrawing() are never called.
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    } else {
+        SetConfigFlags(FLAG_MSAA_4X_HINT | FLAG_WINDOW_RESIZABLE);
+    }
     InitWindow(16*scale_factor, 9*scale_factor, "Panim");
     InitAudioDevice();
-    SetTargetFPS(60);
-    SetExitKey(KEY_NULL);
+    ffmpeg_mixer = mixer_create();
+    preview_mixer = mixer_create();
     plug_init();
 
-    screen = LoadRenderTexture(FFMPEG_VIDEO_WIDTH, FFMPEG_VIDEO_HEIGHT);
+    screen = LoadRenderTexture(profile.width, profile.height);
+    yuv_loaded = yuv_load(&yuv, profile.width, profile.height);
+
+    if (render_path) {
+        bool ok = false;
+        bool audio_only = nob_sv_end_with(nob_sv_from_cstr(render_path), ".wav");
+        if (render_jobs > 1 && !audio_only) {
+            ok = render_parallel(libplug_path, render_path, render_with_sound, render_jobs, render_frames_begin, render_frames_end, profile_flags);
+        } else {
+            ok = render_headless(render_path, render_with_sound, render_frames_begin, render_frames_end, render_progress);
+        }
+        unload_export_targets();
+        CloseAudioDevice();
+        CloseWindow();
+        trace_stop();
+        return ok ? 0 : 1;
+    }
+
+    preview_stream = LoadAudioStream(FFMPEG_SOUND_SAMPLE_RATE, FFMPEG_SOUND_SAMPLE_SIZE_BITS, FFMPEG_SOUND_CHANNELS);
+    SetAudioStreamCallback(preview_stream, preview_stream_callback);
+    PlayAudioStream(preview_stream);
+    hud = hud_create();
+    start_auto_reload(libplug_path);
+
+    SetTargetFPS(60);
+    SetExitKey(KEY_NULL);
     rendering_font = LoadFontEx("./assets/fonts/Vollkorn-Regular.ttf", RENDERING_FONT_SIZE, NULL, 0);
 
     while (!WindowShouldClose()) {
+        // The audio thread keeps mixing the preview in between the frames
+        mixer_update(preview_mixer);
+        assets_update(PREVIEW_UPLOAD_BUDGET);
+        trace_flush();
+        // Not while exporting, the animation must not change under the renderer
+        if (!ffmpeg_video && !ffmpeg_audio) update_auto_reload(libplug_path);
+
         if (IsKeyPressed(KEY_Q)) {
             nob_log(NOB_INFO, "Closing the window");
             break;;
@@ -184,22 +1105,8 @@ int main(int argc, char **argv) {
                     finish_ffmpeg_video_rendering(false);
                 } else if (IsKeyPressed(KEY_ESCAPE)) {
                     finish_ffmpeg_video_rendering(true);
-                } else {
-                    BeginTextureMode(screen);
-                    plug_update(CLITERAL(Env) {
-                        .screen_width = FFMPEG_VIDEO_WIDTH,
-                        .screen_height = FFMPEG_VIDEO_HEIGHT,
-                        .delta_time = FFMPEG_VIDEO_DELTA_TIME,
-                        .rendering = true,
-                        .play_sound = dummy_play_sound,
-                    });
-                    EndTextureMode();
-
-                    Image image = LoadImageFromTexture(screen.texture);
-                    if (!ffmpeg_send_frame_flipped(ffmpeg_video, image.data, image.width, image.height)) {
-                        finish_ffmpeg_video_rendering(true);
-                    }
-                    UnloadImage(image);
+                } else if (!render_video_frame()) {
+                    finish_ffmpeg_video_rendering(true);
                 }
                 rendering_scene("Rendering Video");
             } else if (ffmpeg_audio) {
@@ -207,58 +1114,20 @@ int main(int argc, char **argv) {
                     finish_ffmpeg_audio_rendering(false);
                 } else if (IsKeyPressed(KEY_ESCAPE)) {
                     finish_ffmpeg_audio_rendering(true);
-                } else {
-                    BeginTextureMode(screen);
-                    plug_update(CLITERAL(Env) {
-                        .screen_width = FFMPEG_VIDEO_WIDTH,
-                        .screen_height = FFMPEG_VIDEO_HEIGHT,
-                        .delta_time = FFMPEG_VIDEO_DELTA_TIME,
-                        .rendering = true,
-                        .play_sound = ffmpeg_play_sound,
-                    });
-                    EndTextureMode();
-
-                    // Image image = LoadImageFromTexture(screen.texture);
-                    // if (!ffmpeg_send_frame_flipped(ffmpeg, image.data, image.width, image.height)) {
-                    //     finish_ffmpeg_rendering();
-                    // }
-                    // UnloadImage(image);
-
-                    size_t frame_count = ffmpeg_wave.frameCount;
-                    size_t frame_size = FFMPEG_SOUND_SAMPLE_SIZE_BYTES*FFMPEG_SOUND_CHANNELS;
-                    size_t frames_begin = ffmpeg_wave_cursor;
-                    size_t frames_end = ffmpeg_wave_cursor + FFMPEG_SOUND_SPF;
-                    if (frames_end > frame_count) {
-                        frames_end = frame_count;
-                    }
-                    void *sound_data = (uint8_t*)ffmpeg_wave.data + frames_begin*frame_size;
-                    size_t sound_size = (frames_end - frames_begin)*frame_size;
-                    // TraceLog(LOG_WARNING, "SOUND: %zu", sound_size);
-                    if (!ffmpeg_send_sound_samples(ffmpeg_audio, sound_data, sound_size)) {
-                        finish_ffmpeg_audio_rendering(true);
-                    }
-                    ffmpeg_wave_cursor += frames_end - frames_begin;
-                    size_t silence_size = (FFMPEG_SOUND_SPF - (frames_end - frames_begin))*frame_size;
-                    // TraceLog(LOG_WARNING, "SOUND: %zu", silence_size);
-                    if (!ffmpeg_send_sound_samples(ffmpeg_audio, silence, silence_size)) {
-                        finish_ffmpeg_audio_rendering(true);
-                    }
+                } else if (!render_audio_frame()) {
+                    finish_ffmpeg_audio_rendering(true);
                 }
                 rendering_scene("Rendering Audio");
             } else {
                 if (IsKeyPressed(KEY_R)) {
-                    SetTraceLogLevel(LOG_WARNING);
-                    ffmpeg_video = ffmpeg_start_rendering_video("output.mp4", FFMPEG_VIDEO_WIDTH, FFMPEG_VIDEO_HEIGHT, FFMPEG_VIDEO_FPS);
+                    start_ffmpeg_video_rendering("output.mp4", true, 0, 0);
                     plug_reset();
                 } else if (IsKeyPressed(KEY_T)) {
-                    SetTraceLogLevel(LOG_WARNING);
-                    ffmpeg_audio = ffmpeg_start_rendering_audio("output.wav");
+                    start_ffmpeg_audio_rendering("output.wav", 0);
                     plug_reset();
                 } else {
                     if (IsKeyPressed(KEY_H)) {
-                        void *state = plug_pre_reload();
-                        reload_libplug(libplug_path);
-                        plug_post_reload(state);
+                        hot_reload(libplug_path);
                     }
 
                     if (IsKeyPressed(KEY_SPACE)) {
@@ -277,18 +1146,32 @@ int main(int argc, char **argv) {
                         delta_time_multiplier -= 0.1;
                         delta_time_multiplier_popup = 1.0f;
                     }
+                    if (IsKeyPressed(KEY_P)) {
+                        hud_visible = !hud_visible;
+                    }
                     if (IsKeyPressed(KEY_ZERO)) {
                         delta_time_multiplier = 1.0;
                         delta_time_multiplier_popup = 1.0f;
                     }
 
+                    hud_frame_begin(hud);
+                    trace_begin("plug_update");
                     plug_update(CLITERAL(Env) {
                         .screen_width = GetScreenWidth(),
                         .screen_height = GetScreenHeight(),
                         .delta_time = paused ? 0.0 : GetFrameTime()*delta_time_multiplier,
                         .rendering = false,
                         .play_sound = preview_play_sound,
+                        .play_wave = preview_play_wave,
+                        .play_stream = preview_play_stream,
+                        .trace = &trace_funcs,
                     });
+                    trace_end();
+                    hud_mark(hud, HUD_STAGE_UPDATE);
+                    hud_scene_end(hud);
+                    // Taking the stats also restarts the task counters, so it happens every frame
+                    Plug_Stats stats = {0};
+                    if (plug_stats) stats = plug_stats();
 
                     const char *text = TextFormat("Delta Time Multiplier: %.2fx", delta_time_multiplier);
                     Vector2 text_size = MeasureTextEx(rendering_font, text, RENDERING_FONT_SIZE, 0);
@@ -301,10 +1184,17 @@ int main(int argc, char **argv) {
                     if (delta_time_multiplier_popup > 0.0f) {
                         delta_time_multiplier_popup = (delta_time_multiplier_popup*POPUP_DISAPPER_TIME - GetFrameTime())/POPUP_DISAPPER_TIME;
                     }
+                    if (hud_visible) hud_draw(hud, plug_stats ? &stats : NULL);
                 }
             }
         EndDrawing();
     }
+    hud_destroy(hud);
+    watch_destroy(watch);
+    UnloadAudioStream(preview_stream);
+    unload_export_targets();
+    CloseAudioDevice();
     CloseWindow();
+    trace_stop();
     return 0;
 }
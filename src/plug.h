@@ -11,8 +11,15 @@
     PLUG(plug_reset, void, void)          /* Reset the state of the animation */ \
     PLUG(plug_finished, bool, void)       /* Check if the animation is finished */ \
 
+// The plugin may leave these out. The host falls back to its own implementation then.
+#define LIST_OF_OPTIONAL_PLUGS \
+    PLUG(plug_seek, void, Env, float)     /* Reset the animation and advance it to the time t in steps of env.delta_time without drawing */ \
+    PLUG(plug_stats, Plug_Stats, void)    /* Report the memory and the tasks of the animation for the performance HUD */ \
+    PLUG(plug_set_assets, void, const Asset_Funcs*) /* Receive the asset cache of the host before plug_init() and plug_post_reload() */ \
+
 #define PLUG(name, ret, ...) ret (*name)(__VA_ARGS__);
 LIST_OF_PLUGS
+LIST_OF_OPTIONAL_PLUGS
 #undef PLUG
 
 #endif // PLUG_H_
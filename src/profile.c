@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nob.h"
+#include "profile.h"
+
+static const Export_Profile profiles[] = {
+    {
+        .name = "draft",
+        .width = 960, .height = 540, .fps = 30,
+        .codec = "libx264", .preset = "ultrafast", .crf = 28,
+    },
+    {
+        .name = "final",
+        .width = 1920, .height = 1080, .fps = 60,
+        .codec = "libx264", .preset = "medium", .crf = 18,
+    },
+    {
+        .name = "4k",
+        .width = 3840, .height = 2160, .fps = 60,
+        .codec = "libx264", .preset = "slow", .crf = 18,
+    },
+};
+
+bool profile_find(const char *name, Export_Profile *profile) {
+    for (size_t i = 0; i < NOB_ARRAY_LEN(profiles); ++i) {
+        if (strcmp(profiles[i].name, name) == 0) {
+            *profile = profiles[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+void profile_print_names(void) {
+    for (size_t i = 0; i < NOB_ARRAY_LEN(profiles); ++i) {
+        const Export_Profile *p = &profiles[i];
+        fprintf(stderr, "        %-8s %zux%zu %zufps %s %s crf %zu\n", p->name, p->width, p->height, p->fps, p->codec, p->preset, p->crf);
+    }
+}
+
+static bool parse_size(Nob_String_View value, size_t *size) {
+    const char *cstr = nob_temp_sv_to_cstr(value);
+    char *endptr = NULL;
+    unsigned long long result = strtoull(cstr, &endptr, 10);
+    if (endptr == cstr || *endptr != '\0') return false;
+    *size = result;
+    return true;
+}
+
+bool profile_load_config(const char *path, Export_Profile *profile) {
+    Nob_String_Builder sb = {0};
+    if (!nob_read_entire_file(path, &sb)) return false;
+
+    bool ok = true;
+    Nob_String_View content = nob_sv_from_parts(sb.items, sb.count);
+    for (size_t line_number = 1; content.count > 0 && ok; ++line_number) {
+        Nob_String_View line = nob_sv_chop_by_delim(&content, '\n');
+        line = nob_sv_trim(nob_sv_chop_by_delim(&line, '#'));
+        if (line.count == 0) continue;
+
+        Nob_String_View key = nob_sv_trim(nob_sv_chop_by_delim(&line, '='));
+        Nob_String_View value = nob_sv_trim(line);
+        // The strings outlive the config file, so they are never freed
+        char *value_cstr = strndup(value.data, value.count);
+
+        bool valid = true;
+        if (nob_sv_eq(key, nob_sv_from_cstr("profile"))) {
+            valid = profile_find(value_cstr, profile);
+        } else if (nob_sv_eq(key, nob_sv_from_cstr("width"))) {
+            valid = parse_size(value, &profile->width);
+        } else if (nob_sv_eq(key, nob_sv_from_cstr("height"))) {
+            valid = parse_size(value, &profile->height);
+        } else if (nob_sv_eq(key, nob_sv_from_cstr("fps"))) {
+            valid = parse_size(value, &profile->fps);
+        } else if (nob_sv_eq(key, nob_sv_from_cstr("codec"))) {
+            profile->codec = value_cstr;
+        } else if (nob_sv_eq(key, nob_sv_from_cstr("preset"))) {
+            profile->preset = value.count > 0 ? value_cstr : NULL;
+        } else if (nob_sv_eq(key, nob_sv_from_cstr("crf"))) {
+            valid = parse_size(value, &profile->crf);
+        } else if (nob_sv_eq(key, nob_sv_from_cstr("bitrate"))) {
+            profile->bitrate = value_cstr;
+            profile->crf = 0;
+        } else {
+            nob_log(NOB_ERROR, "%s:%zu: unknown key "SV_Fmt, path, line_number, SV_Arg(key));
+            ok = false;
+            continue;
+        }
+        if (!valid) {
+            nob_log(NOB_ERROR, "%s:%zu: invalid value "SV_Fmt" for "SV_Fmt, path, line_number, SV_Arg(value), SV_Arg(key));
+            ok = false;
+        }
+    }
+
+    nob_sb_free(sb);
+    return ok;
+}
+
+bool profile_valid(const Export_Profile *profile) {
+    if (profile->width == 0 || profile->height == 0 || profile->fps == 0) {
+        nob_log(NOB_ERROR, "The export profile needs a non-zero width, height and fps");
+        return false;
+    }
+    if (profile->crf == 0 && profile->bitrate == NULL) {
+        nob_log(NOB_ERROR, "The export profile needs either a crf or a bitrate");
+        return false;
+    }
+    return true;
+}
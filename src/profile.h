@@ -0,0 +1,29 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Everything that decides how expensive an export is. The resolution is also the
+// resolution the animation is rendered at, not just the one it is scaled to.
+typedef struct {
+    const char *name;
+    size_t width;
+    size_t height;
+    size_t fps;
+    const char *codec;   // ffmpeg video encoder
+    const char *preset;  // Encoder preset, NULL for the encoder's default
+    size_t crf;          // Constant rate factor, 0 to encode at the bitrate instead
+    const char *bitrate; // e.g. "2500k", used when crf is 0
+} Export_Profile;
+
+#define DEFAULT_EXPORT_PROFILE "final"
+
+bool profile_find(const char *name, Export_Profile *profile);
+// Applies the `key = value` lines of the file on top of the profile. The keys are the
+// fields of Export_Profile, and `profile = <name>` starts over from a named profile.
+bool profile_load_config(const char *path, Export_Profile *profile);
+bool profile_valid(const Export_Profile *profile);
+void profile_print_names(void);
+
+#endif // PROFILE_H_
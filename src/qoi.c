@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qoi.h"
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+#define QOI_OP_RGBA  0xff
+#define QOI_HEADER_SIZE 14
+#define QOI_END_MARKER_SIZE 8
+#define QOI_MAX_RUN 62
+
+typedef union {
+    struct { uint8_t r, g, b, a; } rgba;
+    uint32_t v;
+} Qoi_Pixel;
+
+static void write_u32_be(uint8_t *bytes, size_t *p, uint32_t value) {
+    bytes[(*p)++] = (value >> 24) & 0xFF;
+    bytes[(*p)++] = (value >> 16) & 0xFF;
+    bytes[(*p)++] = (value >> 8) & 0xFF;
+    bytes[(*p)++] = value & 0xFF;
+}
+
+uint8_t *qoi_encode_rgba(const uint8_t *pixels, size_t width, size_t height, ptrdiff_t stride, size_t *size) {
+    // Worst case every pixel is a QOI_OP_RGBA
+    size_t capacity = QOI_HEADER_SIZE + width*height*5 + QOI_END_MARKER_SIZE;
+    uint8_t *bytes = malloc(capacity);
+    assert(bytes != NULL && "Buy MORE RAM lol!!");
+
+    size_t p = 0;
+    bytes[p++] = 'q';
+    bytes[p++] = 'o';
+    bytes[p++] = 'i';
+    bytes[p++] = 'f';
+    write_u32_be(bytes, &p, width);
+    write_u32_be(bytes, &p, height);
+    bytes[p++] = 4; // RGBA
+    bytes[p++] = 0; // sRGB with linear alpha
+
+    Qoi_Pixel index[64];
+    memset(index, 0, sizeof(index));
+    Qoi_Pixel prev = {.rgba = {0, 0, 0, 255}};
+    size_t run = 0;
+
+    for (size_t y = 0; y < height; ++y) {
+        const uint8_t *row = pixels + (ptrdiff_t)y*stride;
+        for (size_t x = 0; x < width; ++x) {
+            Qoi_Pixel px;
+            memcpy(&px, row + x*4, sizeof(px));
+
+            if (px.v == prev.v) {
+                run += 1;
+                if (run == QOI_MAX_RUN) {
+                    bytes[p++] = QOI_OP_RUN | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                bytes[p++] = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+
+            size_t hash = (px.rgba.r*3 + px.rgba.g*5 + px.rgba.b*7 + px.rgba.a*11)%64;
+            if (index[hash].v == px.v) {
+                bytes[p++] = QOI_OP_INDEX | hash;
+            } else {
+                index[hash] = px;
+                if (px.rgba.a == prev.rgba.a) {
+                    int8_t vr = px.rgba.r - prev.rgba.r;
+                    int8_t vg = px.rgba.g - prev.rgba.g;
+                    int8_t vb = px.rgba.b - prev.rgba.b;
+                    int8_t vg_r = vr - vg;
+                    int8_t vg_b = vb - vg;
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        bytes[p++] = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                    } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                        bytes[p++] = QOI_OP_LUMA | (vg + 32);
+                        bytes[p++] = (vg_r + 8) << 4 | (vg_b + 8);
+                    } else {
+                        bytes[p++] = QOI_OP_RGB;
+                        bytes[p++] = px.rgba.r;
+                        bytes[p++] = px.rgba.g;
+                        bytes[p++] = px.rgba.b;
+                    }
+                } else {
+                    bytes[p++] = QOI_OP_RGBA;
+                    bytes[p++] = px.rgba.r;
+                    bytes[p++] = px.rgba.g;
+                    bytes[p++] = px.rgba.b;
+                    bytes[p++] = px.rgba.a;
+                }
+            }
+            prev = px;
+        }
+    }
+    if (run > 0) bytes[p++] = QOI_OP_RUN | (run - 1);
+
+    for (size_t i = 0; i < QOI_END_MARKER_SIZE - 1; ++i) bytes[p++] = 0;
+    bytes[p++] = 1;
+
+    *size = p;
+    return bytes;
+}
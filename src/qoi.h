@@ -0,0 +1,15 @@
+#ifndef QOI_H_
+#define QOI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Encoder of the "Quite OK Image" format (https://qoiformat.org/) for RGBA frames.
+// It's a single pass over the pixels, several times faster than PNG at a similar size
+// for flat animation frames, which is what the image sequence export is after.
+
+// Rows are `stride` bytes apart, so a negative stride starting at the last row encodes
+// a bottom-up frame as it comes from OpenGL. Returns a malloc()-ed buffer of `*size` bytes.
+uint8_t *qoi_encode_rgba(const uint8_t *pixels, size_t width, size_t height, ptrdiff_t stride, size_t *size);
+
+#endif // QOI_H_
@@ -0,0 +1,97 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <raylib.h>
+#include "gl.h"
+#include "readback.h"
+
+struct Readback {
+    unsigned int pbos[READBACK_RING_SIZE];
+    GLsync fences[READBACK_RING_SIZE];
+    size_t head; // Amount of frames pushed so far
+    size_t tail; // Amount of frames unmapped so far
+    size_t width;
+    size_t height;
+};
+
+Readback *readback_create(size_t width, size_t height) {
+    Readback *rb = malloc(sizeof(Readback));
+    assert(rb != NULL && "Buy MORE RAM lol!!");
+    memset(rb, 0, sizeof(*rb));
+    rb->width = width;
+    rb->height = height;
+
+    glGenBuffers(READBACK_RING_SIZE, rb->pbos);
+    for (size_t i = 0; i < READBACK_RING_SIZE; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, width*height*4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return rb;
+}
+
+void readback_destroy(Readback *rb) {
+    for (size_t i = rb->tail; i < rb->head; ++i) {
+        glDeleteSync(rb->fences[i%READBACK_RING_SIZE]);
+    }
+    glDeleteBuffers(READBACK_RING_SIZE, rb->pbos);
+    free(rb);
+}
+
+bool readback_full(Readback *rb) {
+    return rb->head - rb->tail >= READBACK_RING_SIZE;
+}
+
+bool readback_empty(Readback *rb) {
+    return rb->head == rb->tail;
+}
+
+void readback_push(Readback *rb, RenderTexture2D target) {
+    assert(!readback_full(rb));
+    assert((size_t)target.texture.width == rb->width && (size_t)target.texture.height == rb->height);
+
+    size_t index = rb->head%READBACK_RING_SIZE;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target.id);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbos[index]);
+    glReadPixels(0, 0, rb->width, rb->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    rb->fences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    rb->head += 1;
+}
+
+void *readback_map(Readback *rb) {
+    assert(!readback_empty(rb));
+
+    size_t index = rb->tail%READBACK_RING_SIZE;
+    for (;;) {
+        unsigned int status = glClientWaitSync(rb->fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000*1000*1000);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) break;
+        if (status == GL_WAIT_FAILED) {
+            TraceLog(LOG_ERROR, "READBACK: could not wait for the frame %zu to be copied", rb->tail);
+            return NULL;
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbos[index]);
+    void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rb->width*rb->height*4, GL_MAP_READ_BIT);
+    if (pixels == NULL) {
+        TraceLog(LOG_ERROR, "READBACK: could not map the pixel buffer of the frame %zu", rb->tail);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    return pixels;
+}
+
+void readback_unmap(Readback *rb) {
+    assert(!readback_empty(rb));
+
+    size_t index = rb->tail%READBACK_RING_SIZE;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbos[index]);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glDeleteSync(rb->fences[index]);
+    rb->fences[index] = NULL;
+    rb->tail += 1;
+}
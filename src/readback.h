@@ -0,0 +1,26 @@
+#ifndef READBACK_H_
+#define READBACK_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <raylib.h>
+
+// Asynchronous readback of render textures through a ring of pixel buffer objects.
+// A pushed frame is copied into a PBO by the GPU in the background and only mapped
+// READBACK_RING_SIZE-1 frames later, so the render thread never waits for glReadPixels.
+
+#define READBACK_RING_SIZE 3
+
+typedef struct Readback Readback;
+
+Readback *readback_create(size_t width, size_t height);
+void readback_destroy(Readback *rb);
+bool readback_full(Readback *rb);
+bool readback_empty(Readback *rb);
+// Starts copying the pixels of the target into the next free PBO. The ring must not be full.
+void readback_push(Readback *rb, RenderTexture2D target);
+// Waits for the oldest pushed frame and maps its pixels. The pointer is valid until readback_unmap().
+void *readback_map(Readback *rb);
+void readback_unmap(Readback *rb);
+
+#endif // READBACK_H_
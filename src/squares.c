@@ -34,6 +34,7 @@ typedef struct {
 } Plug;
 
 static Plug *p = NULL;
+static const Asset_Funcs *assets = NULL;
 
 Vector2 grid(size_t row, size_t col) {
     Vector2 world;
@@ -43,14 +44,14 @@ Vector2 grid(size_t row, size_t col) {
 }
 
 static void load_assets(void) {
-    p->font = LoadFontEx("./assets/fonts/Vollkorn-Regular.ttf", FONT_SIZE, NULL, 0);
+    p->font = assets->load_font("./assets/fonts/Vollkorn-Regular.ttf", FONT_SIZE, NULL, false, TEXTURE_FILTER_POINT);
     Arena *a = &p->asset_arena;
     arena_reset(a);
     task_vtable_rebuild(a);
 }
 
 static void unload_assets(void) {
-    UnloadFont(p->font);
+    assets->unload_font(p->font);
 }
 
 Task shuffle_squares(Arena *a, Square *s1, Square *s2, Square *s3) {
@@ -94,6 +95,10 @@ void plug_reset(void) {
     p->task = loading(a);
 }
 
+void plug_set_assets(const Asset_Funcs *funcs) {
+    assets = funcs;
+}
+
 void plug_init(void) {
     p = malloc(sizeof(*p));
     assert(p != NULL);
@@ -120,8 +125,25 @@ void plug_post_reload(void *state) {
     load_assets();
 }
 
+void plug_seek(Env env, float t) {
+    plug_reset();
+    size_t frames = roundf(t/env.delta_time);
+    for (size_t i = 0; i < frames && !p->finished; ++i) {
+        p->finished = task_update(p->task, env);
+    }
+}
+
+Plug_Stats plug_stats(void) {
+    Plug_Stats stats = {0};
+    task_stats_take(&stats);
+    task_stats_arena(&stats, &p->state_arena);
+    task_stats_arena(&stats, &p->asset_arena);
+    return stats;
+}
+
 void plug_update(Env env) {
     p->finished = task_update(p->task, env);
+    if (env.no_draw) return;
 
     ClearBackground(BACKGROUND_COLOR);
 
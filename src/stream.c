@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <raylib.h>
+
+#include "stream.h"
+
+struct Sound_Stream {
+    int fd;
+    size_t channels;
+    size_t sample_rate;
+    off_t data_offset;
+    size_t frame_count;
+    size_t cursor;           // The next frame read from the file, only touched by the filling thread
+    atomic_size_t head;      // Frames written into the ring so far
+    atomic_size_t tail;      // Frames taken out of the ring so far
+    atomic_bool eof;
+    int16_t *ring;
+};
+
+static uint32_t get_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static bool read_exactly(int fd, void *data, size_t size, off_t offset) {
+    ssize_t n = pread(fd, data, size, offset);
+    return n >= 0 && (size_t)n == size;
+}
+
+// Walks the RIFF chunks up to the samples
+static bool parse_header(Sound_Stream *stream, const char *path) {
+    uint8_t riff[12];
+    if (!read_exactly(stream->fd, riff, sizeof(riff), 0) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        TraceLog(LOG_ERROR, "STREAM: %s is not a .wav file", path);
+        return false;
+    }
+
+    bool has_format = false;
+    off_t offset = sizeof(riff);
+    for (;;) {
+        uint8_t chunk[8];
+        if (!read_exactly(stream->fd, chunk, sizeof(chunk), offset)) {
+            TraceLog(LOG_ERROR, "STREAM: %s has no samples", path);
+            return false;
+        }
+        uint32_t size = get_u32(chunk + 4);
+        offset += sizeof(chunk);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (size < sizeof(fmt) || !read_exactly(stream->fd, fmt, sizeof(fmt), offset)) {
+                TraceLog(LOG_ERROR, "STREAM: %s has a broken format chunk", path);
+                return false;
+            }
+            uint16_t format = get_u16(fmt + 0);
+            uint16_t bits = get_u16(fmt + 14);
+            stream->channels = get_u16(fmt + 2);
+            stream->sample_rate = get_u32(fmt + 4);
+            if (format != 1 || bits != 16 || (stream->channels != 1 && stream->channels != 2)) {
+                TraceLog(LOG_ERROR, "STREAM: %s must be 16 bit PCM with 1 or 2 channels to be streamed", path);
+                return false;
+            }
+            has_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!has_format) {
+                TraceLog(LOG_ERROR, "STREAM: %s has samples before the format", path);
+                return false;
+            }
+            stream->data_offset = offset;
+            stream->frame_count = size/(stream->channels*sizeof(int16_t));
+            // Files that were not finished properly often have the size left at 0 or at the maximum
+            off_t file_size = lseek(stream->fd, 0, SEEK_END);
+            size_t file_frames = (file_size - offset)/(stream->channels*sizeof(int16_t));
+            if (stream->frame_count == 0 || stream->frame_count > file_frames) stream->frame_count = file_frames;
+            return true;
+        }
+        offset += size + (size & 1);
+    }
+}
+
+Sound_Stream *sound_stream_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        TraceLog(LOG_ERROR, "STREAM: could not open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    Sound_Stream *stream = calloc(1, sizeof(*stream));
+    if (stream == NULL) {
+        close(fd);
+        return NULL;
+    }
+    stream->fd = fd;
+    if (!parse_header(stream, path)) {
+        close(fd);
+        free(stream);
+        return NULL;
+    }
+    stream->ring = malloc(SOUND_STREAM_RING_FRAMES*stream->channels*sizeof(int16_t));
+    if (stream->ring == NULL) {
+        close(fd);
+        free(stream);
+        return NULL;
+    }
+    posix_fadvise(fd, stream->data_offset, 0, POSIX_FADV_SEQUENTIAL);
+    return stream;
+}
+
+void sound_stream_close(Sound_Stream *stream) {
+    if (stream == NULL) return;
+    close(stream->fd);
+    free(stream->ring);
+    free(stream);
+}
+
+size_t sound_stream_channels(Sound_Stream *stream) {
+    return stream->channels;
+}
+
+size_t sound_stream_sample_rate(Sound_Stream *stream) {
+    return stream->sample_rate;
+}
+
+bool sound_stream_fill(Sound_Stream *stream) {
+    size_t frame_size = stream->channels*sizeof(int16_t);
+    size_t head = atomic_load_explicit(&stream->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&stream->tail, memory_order_acquire);
+    size_t free_frames = SOUND_STREAM_RING_FRAMES - (head - tail);
+
+    while (free_frames > 0 && stream->cursor < stream->frame_count) {
+        // The free space may wrap around the end of the ring
+        size_t index = head%SOUND_STREAM_RING_FRAMES;
+        size_t n = SOUND_STREAM_RING_FRAMES - index;
+        if (n > free_frames) n = free_frames;
+        if (n > stream->frame_count - stream->cursor) n = stream->frame_count - stream->cursor;
+
+        ssize_t size = pread(stream->fd, stream->ring + index*stream->channels, n*frame_size, stream->data_offset + stream->cursor*frame_size);
+        if (size < 0) {
+            if (errno == EINTR) continue;
+            TraceLog(LOG_ERROR, "STREAM: could not read the samples: %s", strerror(errno));
+            atomic_store(&stream->eof, true);
+            return false;
+        }
+        if (size == 0) {
+            stream->frame_count = stream->cursor;
+            break;
+        }
+        size_t frames = size/frame_size;
+        stream->cursor += frames;
+        head += frames;
+        free_frames -= frames;
+        atomic_store_explicit(&stream->head, head, memory_order_release);
+    }
+    if (stream->cursor >= stream->frame_count) atomic_store(&stream->eof, true);
+    return true;
+}
+
+size_t sound_stream_read(Sound_Stream *stream, int16_t *output, size_t frame_count) {
+    size_t head = atomic_load_explicit(&stream->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&stream->tail, memory_order_relaxed);
+    size_t available = head - tail;
+    if (frame_count > available) frame_count = available;
+
+    size_t done = 0;
+    while (done < frame_count) {
+        size_t index = (tail + done)%SOUND_STREAM_RING_FRAMES;
+        size_t n = SOUND_STREAM_RING_FRAMES - index;
+        if (n > frame_count - done) n = frame_count - done;
+        memcpy(output + done*stream->channels, stream->ring + index*stream->channels, n*stream->channels*sizeof(int16_t));
+        done += n;
+    }
+    atomic_store_explicit(&stream->tail, tail + frame_count, memory_order_release);
+    return frame_count;
+}
+
+void sound_stream_skip(Sound_Stream *stream, size_t frame_count) {
+    size_t head = atomic_load_explicit(&stream->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&stream->tail, memory_order_relaxed);
+    size_t available = head - tail;
+    if (frame_count <= available) {
+        atomic_store_explicit(&stream->tail, tail + frame_count, memory_order_release);
+        return;
+    }
+
+    // The ring is empty now, so the rest is skipped by moving the cursor of the file
+    atomic_store_explicit(&stream->tail, head, memory_order_release);
+    frame_count -= available;
+    stream->cursor += frame_count;
+    if (stream->cursor > stream->frame_count) stream->cursor = stream->frame_count;
+    if (stream->cursor >= stream->frame_count) atomic_store(&stream->eof, true);
+}
+
+bool sound_stream_finished(Sound_Stream *stream) {
+    if (!atomic_load(&stream->eof)) return false;
+    size_t head = atomic_load_explicit(&stream->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&stream->tail, memory_order_relaxed);
+    return head == tail;
+}
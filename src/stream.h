@@ -0,0 +1,31 @@
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Plays a long 16 bit PCM .wav from the disk instead of loading it whole. The samples are read
+// ahead into a ring buffer of about one and a half seconds of 44100hz sound, so a track of any
+// length costs the same memory. One thread fills the ring while another one reads it, no locks
+// are needed.
+
+#define SOUND_STREAM_RING_FRAMES (1 << 16)
+
+typedef struct Sound_Stream Sound_Stream;
+
+Sound_Stream *sound_stream_open(const char *path);
+void sound_stream_close(Sound_Stream *stream);
+size_t sound_stream_channels(Sound_Stream *stream);
+size_t sound_stream_sample_rate(Sound_Stream *stream);
+// Reads the file ahead until the ring is full or the file ends
+bool sound_stream_fill(Sound_Stream *stream);
+// Takes up to `frame_count` frames out of the ring, returns how many there were
+size_t sound_stream_read(Sound_Stream *stream, int16_t *output, size_t frame_count);
+// Drops `frame_count` frames, jumping over the ones that were not read ahead yet. Must be called
+// by the thread that fills the stream.
+void sound_stream_skip(Sound_Stream *stream, size_t frame_count);
+// The whole file went through the ring
+bool sound_stream_finished(Sound_Stream *stream);
+
+#endif // STREAM_H_
@@ -11,8 +11,29 @@ Tag TASK_SEQ_TAG = 0;
 Tag TASK_GROUP_TAG = 0;
 Tag TASK_WAIT_TAG = 0;
 
+static size_t tasks_updated = 0;
+static size_t tasks_running = 0;
+
 bool task_update(Task task, Env env) {
-    return task_vtable.items[task.tag].update(task.data, env);
+    bool finished = task_vtable.items[task.tag].update(task.data, env);
+    tasks_updated += 1;
+    if (!finished) tasks_running += 1;
+    return finished;
+}
+
+void task_stats_take(Plug_Stats *stats) {
+    stats->tasks_updated = tasks_updated;
+    stats->tasks_running = tasks_running;
+    tasks_updated = 0;
+    tasks_running = 0;
+}
+
+void task_stats_arena(Plug_Stats *stats, const Arena *a) {
+    for (Region *r = a->begin; r != NULL; r = r->next) {
+        stats->arena_bytes += r->count*sizeof(uintptr_t);
+        stats->arena_capacity += r->capacity*sizeof(uintptr_t);
+        stats->arena_regions += 1;
+    }
 }
 
 Tag task_vtable_register(Arena *a, Task_Funcs funcs) {
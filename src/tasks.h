@@ -20,6 +20,11 @@ typedef struct {
 
 bool task_update(Task task, Env env);
 
+// Fills in the task counters of the stats and starts counting again
+void task_stats_take(Plug_Stats *stats);
+// Adds the memory of the arena to the stats
+void task_stats_arena(Plug_Stats *stats, const Arena *a);
+
 typedef struct {
     Task_Funcs *items;
     size_t count;
@@ -14,18 +14,23 @@ typedef struct {
 } Plug;
 
 static Plug *p;
+static const Asset_Funcs *assets = NULL;
 
 static void load_assets(void) {
-    p->font = LoadFontEx("./assets/fonts/Vollkorn-Regular.ttf", FONT_SIZE, NULL, 0);
+    p->font = assets->load_font("./assets/fonts/Vollkorn-Regular.ttf", FONT_SIZE, NULL, false, TEXTURE_FILTER_POINT);
 }
 
 static void unload_assets(void) {
-    UnloadFont(p->font);
+    assets->unload_font(p->font);
 }
 
 void plug_reset(void) {
 }
 
+void plug_set_assets(const Asset_Funcs *funcs) {
+    assets = funcs;
+}
+
 void plug_init(void) {
     p = malloc(sizeof(*p));
     assert(p != NULL);
@@ -53,6 +58,8 @@ void plug_post_reload(void *state) {
 }
 
 void plug_update(Env env) {
+    if (env.no_draw) return;
+
     Color background_color = ColorFromHSV(0, 0, 0.05);
     Color foreground_color = ColorFromHSV(0, 0, 0.95);
 
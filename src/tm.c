@@ -22,6 +22,9 @@
 #define CELL_WIDTH 200.0f
 #define CELL_HEIGHT 200.0f
 #define FONT_SIZE (CELL_WIDTH*0.52f)
+// The glyphs are distance fields rasterized as the scene draws them, so the text stays sharp under
+// the zoom and the bumps and any character can show up on the tape
+#define SDF_FONT_SIZE 64
 #define CELL_PAD (CELL_WIDTH*0.15f)
 #define START_AT_CELL_INDEX 5
 #define HEAD_MOVING_DURATION 0.4f
@@ -147,10 +150,12 @@ typedef struct {
 
     // Assets (reloads along with plugin, does not change throughout the animation)
     Arena arena_assets;
-    Font iosevka[COUNT_FONT_STYLE];
-    Sound write_sound;
-    Wave write_wave;
-    Texture2D images[COUNT_IMAGES];
+    // Rasterize their glyphs as they are drawn, so they are loaded right away by
+    // assets->load_glyph_font() and drawn with assets->draw_glyph_text()
+    Glyph_Font *iosevka[COUNT_FONT_STYLE];
+    // Loaded in the background by the host, see Asset_Funcs.request_texture()
+    const Wave *write_wave;
+    const Texture2D *images[COUNT_IMAGES];
     Tag TASK_INTRO_TAG;
     Tag TASK_MOVE_HEAD_TAG;
     Tag TASK_WRITE_HEAD_TAG;
@@ -161,6 +166,8 @@ typedef struct {
 } Plug;
 
 static Plug *p = NULL;
+// The host keeps the assets loaded across the reloads, see plug_set_assets()
+static const Asset_Funcs *assets = NULL;
 
 typedef struct {
     Move_Scalar_Data move_scalar;
@@ -267,7 +274,7 @@ bool write_cell_update(Write_Cell_Data *data, Env env) {
     float t2 = wait_interp(&data->wait);
 
     if (t1 < 0.5 && t2 >= 0.5) {
-        env.play_sound(p->write_sound, p->write_wave);
+        env.play_wave(*p->write_wave, 1.0f, 0.0f);
     }
 
     if (data->cell) data->cell->t = smoothstep(t2);
@@ -319,7 +326,7 @@ bool write_head_update(Write_Head_Data *data, Env env) {
     float t2 = wait_interp(&data->wait);
 
     if (t1 < 0.5 && t2 >= 0.5) {
-        env.play_sound(p->write_sound, p->write_wave);
+        env.play_wave(*p->write_wave, 1.0f, 0.0f);
     }
 
     if (cell) cell->t = smoothstep(t2);
@@ -367,7 +374,7 @@ bool write_all_update(Write_All_Data *data, Env env) {
     float t2 = wait_interp(&data->wait);
 
     if (t1 < 0.5 && t2 >= 0.5) {
-        env.play_sound(p->write_sound, p->write_wave);
+        env.play_wave(*p->write_wave, 1.0f, 0.0f);
     }
 
     for (size_t i = 0; i < p->scene.tape.count; ++i) {
@@ -444,24 +451,14 @@ static void load_assets(void) {
     Arena *a = &p->arena_assets;
     arena_reset(a);
 
-    int codepoints_count = 0;
-    int *codepoints = LoadCodepoints("?abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-@./:)→←", &codepoints_count);
-    p->iosevka[FONT_REGULAR] = LoadFontEx("./assets/fonts/iosevka-regular.ttf", FONT_SIZE*3, codepoints, codepoints_count);
-    p->iosevka[FONT_BOLD] = LoadFontEx("./assets/fonts/iosevka-bold.ttf", FONT_SIZE*3, codepoints, codepoints_count);
-    UnloadCodepoints(codepoints);
-    for (size_t i = 0; i < COUNT_FONT_STYLE; ++i) {
-        GenTextureMipmaps(&p->iosevka[i].texture);
-        SetTextureFilter(p->iosevka[i].texture, TEXTURE_FILTER_BILINEAR);
-    }
+    p->iosevka[FONT_REGULAR] = assets->load_glyph_font("./assets/fonts/iosevka-regular.ttf", SDF_FONT_SIZE);
+    p->iosevka[FONT_BOLD] = assets->load_glyph_font("./assets/fonts/iosevka-bold.ttf", SDF_FONT_SIZE);
 
     for (size_t i = 0; i < COUNT_IMAGES; ++i) {
-        p->images[i] = LoadTexture(image_file_paths[i]);
-        GenTextureMipmaps(&p->images[i]);
-        SetTextureFilter(p->images[i], TEXTURE_FILTER_BILINEAR);
+        p->images[i] = assets->request_texture(image_file_paths[i], true, TEXTURE_FILTER_BILINEAR);
     }
 
-    p->write_wave = LoadWave("./assets/sounds/plant-bomb.wav");
-    p->write_sound = LoadSoundFromWave(p->write_wave);
+    p->write_wave = assets->request_wave("./assets/sounds/plant-bomb.wav");
 
     task_vtable_rebuild(a);
     p->TASK_INTRO_TAG = task_vtable_register(a, (Task_Funcs) {
@@ -489,12 +486,11 @@ static void load_assets(void) {
 
 static void unload_assets(void) {
     for (size_t i = 0; i < COUNT_FONT_STYLE; ++i) {
-        UnloadFont(p->iosevka[i]);
+        assets->unload_glyph_font(p->iosevka[i]);
     }
-    UnloadSound(p->write_sound);
-    UnloadWave(p->write_wave);
+    assets->release(p->write_wave);
     for (size_t i = 0; i < COUNT_IMAGES; ++i) {
-        UnloadTexture(p->images[i]);
+        assets->release(p->images[i]);
     }
 }
 
@@ -653,6 +649,10 @@ void plug_reset(void)
         );
 }
 
+void plug_set_assets(const Asset_Funcs *funcs) {
+    assets = funcs;
+}
+
 void plug_init(void) {
     p = malloc(sizeof(*p));
     assert(p != NULL);
@@ -685,14 +685,14 @@ void plug_post_reload(void *state) {
 static void text_in_rec(Rectangle rec, const char *text, Font_Style style, float size, Color color) {
     Vector2 rec_size = { rec.width, rec.height };
     float font_size = size;
-    Vector2 text_size = MeasureTextEx(p->iosevka[style], text, font_size, 0);
+    Vector2 text_size = assets->measure_glyph_text(p->iosevka[style], text, font_size, 0);
     Vector2 position = {
         .x = rec.x,
         .y = rec.y
     };
     position = Vector2Add(position, Vector2Scale(rec_size, 0.5));
     position = Vector2Subtract(position, Vector2Scale(text_size, 0.5));
-    DrawTextEx(p->iosevka[style], text, position, font_size, 0, color);
+    assets->draw_glyph_text(p->iosevka[style], text, position, font_size, 0, color);
 }
 
 static void image_in_rec(Rectangle rec, Texture2D image, float size, Color color) {
@@ -714,7 +714,7 @@ static void symbol_in_rec(Rectangle rec, Symbol symbol, float size, Color color)
             text_in_rec(rec, symbol.text, FONT_REGULAR, size, color);
         } break;
         case SYMBOL_IMAGE: {
-            image_in_rec(rec, p->images[symbol.image_index], size, WHITE);
+            image_in_rec(rec, *p->images[symbol.image_index], size, WHITE);
         } break;
     }
 }
@@ -767,17 +767,8 @@ static void render_table_lines(float x, float y, float field_width, float field_
     }
 }
 
-void plug_update(Env env) {
-    ClearBackground(BACKGROUND_COLOR);
-
-    const float header_font_size = FONT_SIZE*0.45f;
-    const char *text = "Turing Machine";
-    Vector2 text_size = MeasureTextEx(p->iosevka[FONT_REGULAR], text, header_font_size, 0);
-
-    Vector2 position = {env.screen_width/2, header_font_size};
-    position = Vector2Subtract(position, Vector2Scale(text_size, 0.5));
-    DrawTextEx(p->iosevka[FONT_REGULAR], text, position, header_font_size, 0, WHITE);
-    
+// Advances the state of the scene by env.delta_time
+static void scene_update(Env env) {
     p->scene.finished = task_update(p->scene.task, env);
 
     for (size_t i = 0; i < p->scene.table.count; ++i) {
@@ -794,6 +785,43 @@ void plug_update(Env env) {
             *t = ((*t)*BUMP_DECIPATE - env.delta_time)/BUMP_DECIPATE;
         }
     }
+}
+
+void plug_seek(Env env, float t) {
+    plug_reset();
+    size_t frames = roundf(t/env.delta_time);
+    for (size_t i = 0; i < frames && !p->scene.finished; ++i) {
+        scene_update(env);
+    }
+}
+
+Plug_Stats plug_stats(void) {
+    Plug_Stats stats = {0};
+    task_stats_take(&stats);
+    task_stats_arena(&stats, &p->arena_state);
+    task_stats_arena(&stats, &p->arena_assets);
+    return stats;
+}
+
+void plug_update(Env env) {
+    if (env.no_draw) {
+        scene_update(env);
+        return;
+    }
+
+    ClearBackground(BACKGROUND_COLOR);
+
+    const float header_font_size = FONT_SIZE*0.45f;
+    const char *text = "Turing Machine";
+    Vector2 text_size = assets->measure_glyph_text(p->iosevka[FONT_REGULAR], text, header_font_size, 0);
+
+    Vector2 position = {env.screen_width/2, header_font_size};
+    position = Vector2Subtract(position, Vector2Scale(text_size, 0.5));
+    assets->draw_glyph_text(p->iosevka[FONT_REGULAR], text, position, header_font_size, 0, WHITE);
+
+    env.trace->begin("scene_update");
+    scene_update(env);
+    env.trace->end();
 
     float head_thick = 20.0;
     float head_padding = head_thick*2.5;
@@ -821,6 +849,7 @@ void plug_update(Env env) {
     {
         // Tape
         {
+            env.trace->begin("tape");
             for (size_t i = 0; i < p->scene.tape.count; ++i) {
                 Rectangle rec = {
                     .x = i*(CELL_WIDTH + CELL_PAD),
@@ -831,10 +860,12 @@ void plug_update(Env env) {
                 DrawRectangleRec(rec, CELL_COLOR);
                 cell_in_rec(rec, p->scene.tape.items[i], FONT_SIZE, BACKGROUND_COLOR);
             }
+            env.trace->end();
         }
 
         // Head
         {
+            env.trace->begin("head");
             Rectangle state_rec = {
                 .width = head_rec.width,
                 .height = head_rec.height*0.5,
@@ -855,10 +886,12 @@ void plug_update(Env env) {
             watermark.x = state_rec.x,
             watermark.y = state_rec.y + state_rec.height;
             text_in_rec(watermark, "x.com/realsanjeev2", FONT_REGULAR, FONT_SIZE*0.25, ColorAlpha(CELL_COLOR, p->scene.t*0.5));
+            env.trace->end();
         }
 
         // Table
         {
+            env.trace->begin("table");
             float top_margin = 300.0;
             float right_margin = 70.0;
             float symbol_size = FONT_SIZE*0.75;
@@ -928,6 +961,7 @@ void plug_update(Env env) {
                 field_height + head_padding,
                 1, 1,
                 p->scene.table.head_t, head_thick, HEAD_COLOR);
+            env.trace->end();
         }
     }
     EndMode2D();
@@ -0,0 +1,187 @@
+#define _GNU_SOURCE // gettid()
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include <unistd.h>
+
+#include <raylib.h>
+
+#include "trace.h"
+
+// Events of one thread that fit between two flushes. The rest is dropped and reported on stop.
+#define TRACE_RING_SIZE (1 << 13)
+// The names are copied, the plugin that recorded them may be reloaded before they are written
+#define TRACE_NAME_SIZE 48
+
+typedef struct {
+    uint64_t ts; // Nanoseconds since trace_start()
+    double value;
+    char phase;  // 'B', 'E' or 'C'
+    char name[TRACE_NAME_SIZE];
+} Trace_Event;
+
+typedef struct Trace_Buffer {
+    struct Trace_Buffer *next;
+    int tid;
+    char thread_name[TRACE_NAME_SIZE];
+    bool thread_name_written;
+    atomic_size_t head; // Only written by the thread that owns the buffer
+    atomic_size_t tail; // Only written by trace_flush()
+    atomic_size_t dropped;
+    Trace_Event events[TRACE_RING_SIZE];
+} Trace_Buffer;
+
+static atomic_bool trace_enabled = false;
+static _Atomic(Trace_Buffer*) trace_buffers = NULL;
+static _Thread_local Trace_Buffer *trace_buffer = NULL;
+static FILE *trace_file = NULL;
+static size_t trace_events_written = 0;
+static uint64_t trace_epoch = 0;
+
+const Trace_Funcs trace_funcs = {
+    .begin = trace_begin,
+    .end = trace_end,
+    .counter = trace_counter,
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
+
+static Trace_Buffer *thread_buffer(void) {
+    if (trace_buffer) return trace_buffer;
+    Trace_Buffer *buffer = calloc(1, sizeof(*buffer));
+    if (buffer == NULL) return NULL;
+    buffer->tid = gettid();
+    // The buffers are never freed, so pushing them onto the list is all the registration they need
+    buffer->next = atomic_load(&trace_buffers);
+    while (!atomic_compare_exchange_weak(&trace_buffers, &buffer->next, buffer));
+    trace_buffer = buffer;
+    return buffer;
+}
+
+static void record(char phase, const char *name, double value) {
+    uint64_t ts = now_ns() - trace_epoch;
+    Trace_Buffer *buffer = thread_buffer();
+    if (buffer == NULL) return;
+
+    size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+    if (head - tail >= TRACE_RING_SIZE) {
+        atomic_fetch_add_explicit(&buffer->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    Trace_Event *event = &buffer->events[head%TRACE_RING_SIZE];
+    event->ts = ts;
+    event->value = value;
+    event->phase = phase;
+    if (name) {
+        strncpy(event->name, name, TRACE_NAME_SIZE - 1);
+        event->name[TRACE_NAME_SIZE - 1] = '\0';
+    } else {
+        event->name[0] = '\0';
+    }
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+bool trace_start(const char *path) {
+    trace_file = fopen(path, "wb");
+    if (trace_file == NULL) {
+        TraceLog(LOG_ERROR, "TRACE: could not open %s: %s", path, strerror(errno));
+        return false;
+    }
+    fprintf(trace_file, "{\"traceEvents\":[\n");
+    trace_events_written = 0;
+    trace_epoch = now_ns();
+    atomic_store(&trace_enabled, true);
+    return true;
+}
+
+void trace_stop(void) {
+    if (trace_file == NULL) return;
+    trace_flush();
+    atomic_store(&trace_enabled, false);
+    fprintf(trace_file, "\n]}\n");
+    fclose(trace_file);
+    trace_file = NULL;
+
+    size_t dropped = 0;
+    for (Trace_Buffer *buffer = atomic_load(&trace_buffers); buffer; buffer = buffer->next) {
+        dropped += atomic_load(&buffer->dropped);
+    }
+    if (dropped > 0) TraceLog(LOG_WARNING, "TRACE: dropped %zu events, the ring buffers were full", dropped);
+}
+
+void trace_thread_name(const char *name) {
+    if (!atomic_load_explicit(&trace_enabled, memory_order_relaxed)) return;
+    Trace_Buffer *buffer = thread_buffer();
+    if (buffer == NULL) return;
+    strncpy(buffer->thread_name, name, TRACE_NAME_SIZE - 1);
+}
+
+void trace_begin(const char *name) {
+    if (!atomic_load_explicit(&trace_enabled, memory_order_relaxed)) return;
+    record('B', name, 0.0);
+}
+
+void trace_end(void) {
+    if (!atomic_load_explicit(&trace_enabled, memory_order_relaxed)) return;
+    record('E', NULL, 0.0);
+}
+
+void trace_counter(const char *name, double value) {
+    if (!atomic_load_explicit(&trace_enabled, memory_order_relaxed)) return;
+    record('C', name, value);
+}
+
+// The names come from the code, but a quote or a backslash in one would still break the JSON
+static void write_name(const char *name) {
+    for (; *name; ++name) {
+        if (*name == '"' || *name == '\\') fputc('\\', trace_file);
+        if ((unsigned char)*name >= ' ') fputc(*name, trace_file);
+    }
+}
+
+static void write_separator(void) {
+    if (trace_events_written++ > 0) fprintf(trace_file, ",\n");
+}
+
+void trace_flush(void) {
+    if (trace_file == NULL) return;
+    int pid = getpid();
+    for (Trace_Buffer *buffer = atomic_load(&trace_buffers); buffer; buffer = buffer->next) {
+        if (!buffer->thread_name_written && buffer->thread_name[0]) {
+            write_separator();
+            fprintf(trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"", pid, buffer->tid);
+            write_name(buffer->thread_name);
+            fprintf(trace_file, "\"}}");
+            buffer->thread_name_written = true;
+        }
+
+        size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+        for (; tail < head; ++tail) {
+            const Trace_Event *event = &buffer->events[tail%TRACE_RING_SIZE];
+            write_separator();
+            fprintf(trace_file, "{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d", event->phase, event->ts/1000.0, pid, buffer->tid);
+            if (event->phase != 'E') {
+                fprintf(trace_file, ",\"name\":\"");
+                write_name(event->name);
+                fprintf(trace_file, "\"");
+            }
+            if (event->phase == 'C') {
+                fprintf(trace_file, ",\"args\":{\"value\":%g}", event->value);
+            }
+            fprintf(trace_file, "}");
+        }
+        atomic_store_explicit(&buffer->tail, tail, memory_order_release);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>
+
+// Spans and counters in the Chrome trace event format, open the file in chrome://tracing or
+// https://ui.perfetto.dev. Every thread records into its own ring buffer without any locks and
+// the main thread drains all of them into the file with trace_flush(). Recording costs a single
+// branch while the tracing is off.
+
+// What the plugins get through Env, since they cannot link against the host
+typedef struct {
+    void (*begin)(const char *name);
+    void (*end)(void);
+    void (*counter)(const char *name, double value);
+} Trace_Funcs;
+
+extern const Trace_Funcs trace_funcs;
+
+bool trace_start(const char *path);
+void trace_stop(void);
+// Names the calling thread in the viewer
+void trace_thread_name(const char *name);
+void trace_begin(const char *name);
+void trace_end(void);
+void trace_counter(const char *name, double value);
+// Writes out everything the threads recorded so far. Must only be called by one thread.
+void trace_flush(void);
+
+#endif // TRACE_H_
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <raylib.h>
+
+#include "watch.h"
+
+// Editors either write the file in place or write a temporary one and rename it over the original
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+struct Watch {
+    int fd;
+    size_t buffer_size;
+    size_t offset;
+    char buffer[16*(sizeof(struct inotify_event) + NAME_MAX + 1)] __attribute__((aligned(__alignof__(struct inotify_event))));
+};
+
+Watch *watch_create(void) {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        TraceLog(LOG_WARNING, "WATCH: could not initialize inotify: %s", strerror(errno));
+        return NULL;
+    }
+    Watch *watch = calloc(1, sizeof(*watch));
+    if (watch == NULL) {
+        close(fd);
+        return NULL;
+    }
+    watch->fd = fd;
+    return watch;
+}
+
+void watch_destroy(Watch *watch) {
+    if (watch == NULL) return;
+    close(watch->fd);
+    free(watch);
+}
+
+int watch_dir(Watch *watch, const char *dir_path) {
+    int wd = inotify_add_watch(watch->fd, dir_path, WATCH_MASK);
+    if (wd < 0) TraceLog(LOG_WARNING, "WATCH: could not watch %s: %s", dir_path, strerror(errno));
+    return wd;
+}
+
+bool watch_next(Watch *watch, int *dir, const char **file_name) {
+    for (;;) {
+        if (watch->offset >= watch->buffer_size) {
+            ssize_t n = read(watch->fd, watch->buffer, sizeof(watch->buffer));
+            if (n <= 0) {
+                if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                    TraceLog(LOG_WARNING, "WATCH: could not read the changes: %s", strerror(errno));
+                }
+                return false;
+            }
+            watch->buffer_size = n;
+            watch->offset = 0;
+        }
+
+        const struct inotify_event *event = (const struct inotify_event*)(watch->buffer + watch->offset);
+        watch->offset += sizeof(struct inotify_event) + event->len;
+        if (event->len == 0) continue;
+        *dir = event->wd;
+        *file_name = event->name;
+        return true;
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef WATCH_H_
+#define WATCH_H_
+
+#include <stdbool.h>
+
+// Tells which files of the watched directories were written or replaced, without blocking.
+// Built on inotify, so the directories are watched whole and the events carry the file names.
+
+typedef struct Watch Watch;
+
+Watch *watch_create(void);
+void watch_destroy(Watch *watch);
+// Returns the id the events of the directory come with, or -1 on failure
+int watch_dir(Watch *watch, const char *dir_path);
+// Takes the next change out of the queue. The name is valid until the next call.
+// Returns false when there are no more changes for now.
+bool watch_next(Watch *watch, int *dir, const char **file_name);
+
+#endif // WATCH_H_
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <raylib.h>
+
+#include "wav.h"
+
+#define WAV_BUFFER_SIZE (1024*1024)
+#define WAV_HEADER_SIZE 44
+// The sizes in the header are 32 bit, longer files are still playable but report the maximum
+#define WAV_MAX_DATA_SIZE (UINT32_MAX - WAV_HEADER_SIZE + 8)
+
+struct Wav_Writer {
+    int fd;
+    char *path;
+    uint64_t data_size;
+    size_t buffer_size;
+    uint8_t buffer[WAV_BUFFER_SIZE];
+};
+
+static void put_u16(uint8_t *p, uint16_t x) {
+    p[0] = x & 0xFF;
+    p[1] = (x >> 8) & 0xFF;
+}
+
+static void put_u32(uint8_t *p, uint32_t x) {
+    put_u16(p + 0, x & 0xFFFF);
+    put_u16(p + 2, (x >> 16) & 0xFFFF);
+}
+
+static bool write_all(int fd, const uint8_t *data, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t n = offset < 0 ? write(fd, data, size) : pwrite(fd, data, size, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+        if (offset >= 0) offset += n;
+    }
+    return true;
+}
+
+static bool flush(Wav_Writer *wav) {
+    if (!write_all(wav->fd, wav->buffer, wav->buffer_size, -1)) {
+        TraceLog(LOG_ERROR, "WAV: could not write into %s: %s", wav->path, strerror(errno));
+        return false;
+    }
+    wav->buffer_size = 0;
+    return true;
+}
+
+static void header(uint8_t h[WAV_HEADER_SIZE], size_t sample_rate, size_t channels, uint32_t data_size) {
+    memcpy(h + 0, "RIFF", 4);
+    put_u32(h + 4, data_size + WAV_HEADER_SIZE - 8);
+    memcpy(h + 8, "WAVE", 4);
+    memcpy(h + 12, "fmt ", 4);
+    put_u32(h + 16, 16);                        // Size of the fmt chunk
+    put_u16(h + 20, 1);                         // PCM
+    put_u16(h + 22, channels);
+    put_u32(h + 24, sample_rate);
+    put_u32(h + 28, sample_rate*channels*2);    // Byte rate
+    put_u16(h + 32, channels*2);                // Block align
+    put_u16(h + 34, 16);                        // Bits per sample
+    memcpy(h + 36, "data", 4);
+    put_u32(h + 40, data_size);
+}
+
+Wav_Writer *wav_writer_open(const char *path, size_t sample_rate, size_t channels) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        TraceLog(LOG_ERROR, "WAV: could not open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    Wav_Writer *wav = malloc(sizeof(*wav));
+    if (wav == NULL) {
+        close(fd);
+        return NULL;
+    }
+    wav->fd = fd;
+    wav->path = strdup(path);
+    wav->data_size = 0;
+    // The header with empty sizes goes first and is rewritten on close
+    header(wav->buffer, sample_rate, channels, 0);
+    wav->buffer_size = WAV_HEADER_SIZE;
+    return wav;
+}
+
+bool wav_writer_write(Wav_Writer *wav, const void *data, size_t size) {
+    const uint8_t *bytes = data;
+    wav->data_size += size;
+    while (size > 0) {
+        if (wav->buffer_size == WAV_BUFFER_SIZE && !flush(wav)) return false;
+        size_t n = WAV_BUFFER_SIZE - wav->buffer_size;
+        if (n > size) n = size;
+        memcpy(wav->buffer + wav->buffer_size, bytes, n);
+        wav->buffer_size += n;
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool wav_writer_close(Wav_Writer *wav, bool cancel) {
+    bool ok = !cancel && flush(wav);
+    if (ok) {
+        // Only the sizes are patched, the rest of the header is already in the file
+        uint32_t data_size = wav->data_size < WAV_MAX_DATA_SIZE ? wav->data_size : WAV_MAX_DATA_SIZE;
+        uint8_t h[8];
+        put_u32(h + 0, data_size + WAV_HEADER_SIZE - 8);
+        put_u32(h + 4, data_size);
+        ok = write_all(wav->fd, h, 4, 4) && write_all(wav->fd, h + 4, 4, 40);
+        if (!ok) TraceLog(LOG_ERROR, "WAV: could not finish %s: %s", wav->path, strerror(errno));
+    }
+    if (close(wav->fd) < 0 && ok) {
+        TraceLog(LOG_ERROR, "WAV: could not close %s: %s", wav->path, strerror(errno));
+        ok = false;
+    }
+    if (cancel) unlink(wav->path);
+    free(wav->path);
+    free(wav);
+    return ok;
+}
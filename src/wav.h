@@ -0,0 +1,17 @@
+#ifndef WAV_H_
+#define WAV_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Streams interleaved 16 bit PCM samples into a .wav file. The samples are collected in a
+// large buffer and written sequentially, the sizes in the header are filled in on close.
+
+typedef struct Wav_Writer Wav_Writer;
+
+Wav_Writer *wav_writer_open(const char *path, size_t sample_rate, size_t channels);
+bool wav_writer_write(Wav_Writer *wav, const void *data, size_t size);
+// Finishes the file and frees the writer. A canceled file is removed.
+bool wav_writer_close(Wav_Writer *wav, bool cancel);
+
+#endif // WAV_H_
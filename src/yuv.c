@@ -0,0 +1,90 @@
+#include <raylib.h>
+#include <rlgl.h>
+
+#include "yuv.h"
+
+// BT.601 limited range, the same matrix swscale picks for rgba -> yuv420p by default
+static const char *yuv_fs =
+    "#version 330\n"
+    "uniform sampler2D texture0;\n"
+    "uniform ivec2 frameSize;\n"
+    "out vec4 finalColor;\n"
+    "\n"
+    "// Top-down pixel of the frame. OpenGL keeps the textures bottom-up.\n"
+    "vec3 pixel(int x, int y) {\n"
+    "    return texelFetch(texture0, ivec2(x, frameSize.y - 1 - y), 0).rgb;\n"
+    "}\n"
+    "\n"
+    "float luma(vec3 c) {\n"
+    "    return (16.0 + 65.481*c.r + 128.553*c.g + 24.966*c.b)/255.0;\n"
+    "}\n"
+    "\n"
+    "float chroma(int x, int y, bool v) {\n"
+    "    vec3 c = (pixel(2*x, 2*y) + pixel(2*x + 1, 2*y) + pixel(2*x, 2*y + 1) + pixel(2*x + 1, 2*y + 1))*0.25;\n"
+    "    if (v) return (128.0 + 112.0*c.r - 93.786*c.g - 18.214*c.b)/255.0;\n"
+    "    return (128.0 - 37.797*c.r - 74.203*c.g + 112.0*c.b)/255.0;\n"
+    "}\n"
+    "\n"
+    "void main() {\n"
+    "    int w = frameSize.x;\n"
+    "    int h = frameSize.y;\n"
+    "    ivec2 texel = ivec2(gl_FragCoord.xy);\n"
+    "    vec4 bytes;\n"
+    "    if (texel.y < h) {\n"
+    "        for (int i = 0; i < 4; ++i) bytes[i] = luma(pixel(texel.x*4 + i, texel.y));\n"
+    "    } else {\n"
+    "        int plane = (w/2)*(h/2);\n"
+    "        int offset = (texel.y - h)*w + texel.x*4;\n"
+    "        bool v = offset >= plane;\n"
+    "        if (v) offset -= plane;\n"
+    "        int x = offset%(w/2);\n"
+    "        int y = offset/(w/2);\n"
+    "        for (int i = 0; i < 4; ++i) bytes[i] = chroma(x + i, y, v);\n"
+    "    }\n"
+    "    finalColor = bytes;\n"
+    "}\n";
+
+bool yuv_supported(size_t width, size_t height) {
+    // 4 bytes of every texel must belong to the same row of the same plane
+    return width%8 == 0 && height%2 == 0;
+}
+
+bool yuv_load(Yuv *yuv, size_t width, size_t height) {
+    if (!yuv_supported(width, height)) {
+        TraceLog(LOG_WARNING, "YUV: %zux%zu frames can't be converted on the GPU", width, height);
+        return false;
+    }
+
+    yuv->shader = LoadShaderFromMemory(NULL, yuv_fs);
+    if (yuv->shader.id == rlGetShaderIdDefault()) {
+        TraceLog(LOG_WARNING, "YUV: could not compile the conversion shader");
+        return false;
+    }
+    yuv->frame_size_loc = GetShaderLocation(yuv->shader, "frameSize");
+    yuv->target = LoadRenderTexture(width/4, height*3/2);
+    yuv->width = width;
+    yuv->height = height;
+    return true;
+}
+
+void yuv_unload(Yuv *yuv) {
+    UnloadRenderTexture(yuv->target);
+    UnloadShader(yuv->shader);
+}
+
+void yuv_convert(Yuv *yuv, Texture2D frame) {
+    int frame_size[2] = {yuv->width, yuv->height};
+    SetShaderValue(yuv->shader, yuv->frame_size_loc, frame_size, SHADER_UNIFORM_IVEC2);
+
+    BeginTextureMode(yuv->target);
+    // The texels are raw bytes, they must overwrite the target without any blending
+    rlSetBlendFactors(RL_ONE, RL_ZERO, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM);
+    BeginShaderMode(yuv->shader);
+        Rectangle source = {0, 0, frame.width, frame.height};
+        Rectangle dest = {0, 0, yuv->target.texture.width, yuv->target.texture.height};
+        DrawTexturePro(frame, source, dest, (Vector2){0}, 0.0f, WHITE);
+    EndShaderMode();
+    EndBlendMode();
+    EndTextureMode();
+}
@@ -0,0 +1,29 @@
+#ifndef YUV_H_
+#define YUV_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <raylib.h>
+
+// Converts rendered frames into planar I420 (yuv420p) on the GPU.
+//
+// The I420 bytes of a width x height frame are packed into an RGBA8 render texture
+// of width/4 x height*3/2 texels: the Y plane first, then U, then V. The rows are
+// already in the top-down order, so reading the texture back with glReadPixels
+// yields a frame that can be piped to ffmpeg as is at 1.5 bytes per pixel.
+
+typedef struct {
+    Shader shader;
+    int frame_size_loc;
+    RenderTexture2D target;
+    size_t width;
+    size_t height;
+} Yuv;
+
+bool yuv_supported(size_t width, size_t height);
+bool yuv_load(Yuv *yuv, size_t width, size_t height);
+void yuv_unload(Yuv *yuv);
+// Renders the I420 version of the frame into yuv->target
+void yuv_convert(Yuv *yuv, Texture2D frame);
+
+#endif // YUV_H_